@@ -17,6 +17,7 @@ namespace cop5536 {
     protected:
         using super = BST;
         using typename super::Node;
+        size_t num_rotations;
         int insert_at_leaf(size_t nodes_visited,
                            size_t& subtree_root_index,
                            key_type const& key,
@@ -56,11 +57,13 @@ namespace cop5536 {
             subtree_root.right_index = right_child.left_index;
             //original root adopted a subtree (whose height did not change), so update its height
             subtree_root.update_height(nodes);
+            subtree_root.update_max_value(nodes);
 
             //right child adopts original root and its children
             right_child.left_index = subtree_root_index;
             //right child (new root) adopted the original root (whose height has been updated), so update its height
             right_child.update_height(nodes);
+            right_child.update_max_value(nodes);
             //since right child took the subtree root's place, it has the same number of children as the original root
             right_child.num_children = subtree_root.num_children;
 
@@ -74,6 +77,7 @@ namespace cop5536 {
 
             //set the right child as the new root
             subtree_root_index = right_child_index;
+            ++num_rotations;
         }
         void rotate_right(size_t& subtree_root_index) {
             Node& subtree_root = nodes[subtree_root_index];
@@ -84,11 +88,13 @@ namespace cop5536 {
             subtree_root.left_index = left_child.right_index;
             //original root adopted a subtree (whose height did not change), so update its height
             subtree_root.update_height(nodes);
+            subtree_root.update_max_value(nodes);
 
             //left child adopts original root and its children
             left_child.right_index = subtree_root_index;
             //left child (new root) adopted the original root (whose height has been updated), so update its height
             left_child.update_height(nodes);
+            left_child.update_max_value(nodes);
             //since left child took the subtree root's place, it has the same number of children as the original root
             left_child.num_children = subtree_root.num_children;
 
@@ -102,6 +108,7 @@ namespace cop5536 {
 
             //set the left child as the new root
             subtree_root_index = left_child_index;
+            ++num_rotations;
         }
         void balance(size_t& subtree_root_index) {
             if (subtree_root_index == 0) return;
@@ -156,27 +163,24 @@ namespace cop5536 {
                 throw std::domain_error(err.str());
             }
         }
-        void validate_avl_balance(size_t subtree_root_index) const {
-            if (subtree_root_index == 0) return;
-            Node const& n = this->nodes[subtree_root_index];
-            if (abs(n.balance_factor(this->nodes)) > 1)
-                throw std::domain_error("Unexpected unbalanced tree while checking balance factor of all tree nodes");
-            validate_avl_balance(n.left_index);
-            validate_avl_balance(n.right_index);
+        void validate_balance(size_t node_index) const {
+            super::validate_balance(node_index);
+            if (abs(this->nodes[node_index].balance_factor(this->nodes)) > 1)
+                throw std::domain_error("Unexpected unbalanced tree while checking balance factor of a tree node");
         }
-        size_t init_from_kv_list(const kv_list& init_kvs, const size_t start_idx, const size_t end_idx) {
-            size_t root_dst_idx = super::init_from_kv_list(init_kvs, start_idx, end_idx);
+        size_t init_from_sorted_slots(const size_t start_idx, const size_t end_idx) {
+            size_t root_dst_idx = super::init_from_sorted_slots(start_idx, end_idx);
             if (root_dst_idx > 0)
                 balance(root_dst_idx);
             return root_dst_idx;
         }
     public:
-        AVL(size_t init_capacity): super(init_capacity) {}
+        AVL(size_t init_capacity): super(init_capacity), num_rotations(0) {}
         /*
             Initialize an AVL tree using a list of key-values, sorted by key, in O(N) time
         */
-        AVL(const kv_list& init_kvs): AVL(init_kvs.size() * 2) {
-            root_index = init_from_kv_list(init_kvs, 0, init_kvs.size());
+        AVL(const kv_list& init_kvs): AVL(std::max<size_t>(1, init_kvs.size())) {
+            build_from_kv_list(init_kvs);
         }
         /*
             Adds the specified key/value-pair to the tree and returns the number of
@@ -192,10 +196,8 @@ namespace cop5536 {
             key_type k(key);
             value_type v(value);
             int nodes_visited = insert_at_leaf(0, this->root_index, k, v, found_key);
-            if (_DEBUG_) {
-                validate_avl_balance(this->root_index);
-                this->nodes[this->root_index].validate_children_count_recursive(this->nodes);
-            }
+            if (_DEBUG_)
+                this->validate_after_insert(key);
             return nodes_visited;
         }
         /*
@@ -209,14 +211,18 @@ namespace cop5536 {
             key_type k(key);
             value_type v(value);
             int nodes_visited = do_remove(0, this->root_index, k, v, found_key);
-            if (_DEBUG_) {
-                validate_avl_balance(this->root_index);
-                this->nodes[this->root_index].validate_children_count_recursive(this->nodes);
-            }
+            if (_DEBUG_)
+                this->validate_after_remove(key);
             if (found_key)
                 value = v;
             return found_key ? nodes_visited : -1 * nodes_visited;
         }
+        /*
+            returns the number of rotations done since the tree was created.
+        */
+        size_t rotations() const {
+            return num_rotations;
+        }
     };
 }
 
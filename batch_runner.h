@@ -0,0 +1,140 @@
+#ifndef _BATCH_RUNNER_H_
+#define _BATCH_RUNNER_H_
+
+#include "driver.h"
+#include "thread_pool.h"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace cop5536 {
+    template <typename Driver>
+    class BasicBatchRunner {
+    /*
+        Runs a command trace in batches, spreading each long run of read-only commands (count, next, previous,
+        inrange, topk) over a thread pool. Nothing modifies the counter while such a run is in flight, so each
+        thread can walk the tree freely; every thread formats its share of the run into its own buffer, and the
+        buffers are written out in command order, so the output is exactly what running serially would print.
+        Commands that modify the counter run one at a time on the calling thread, between the runs.
+        Input is read a batch at a time, so this is meant for replaying traces rather than interactive use.
+    */
+    private:
+        struct ParsedCommand {
+            Command cmd;
+            bool has_error; //parsing threw, and error holds the message to print in the command's place
+            std::string error;
+        };
+        static const size_t batch_size = 64 * 1024; //commands read before any of them run
+        static const size_t min_commands_per_task = 256; //shorter read-only runs aren't worth handing out
+        Driver& driver;
+        ThreadPool pool;
+        std::vector<ParsedCommand> batch;
+        std::vector<std::ostringstream> task_outputs;
+
+        bool read_batch(std::istream& in) {
+            //parse up to batch_size commands; returns false once quit or the end of the input has been reached
+            batch.clear();
+            std::string line;
+            while (batch.size() != batch_size) {
+                if ( ! std::getline(in, line))
+                    return false;
+                ParsedCommand pc;
+                pc.has_error = false;
+                try {
+                    if ( ! driver.parse(line, pc.cmd))
+                        continue;
+                } catch (std::exception& e) {
+                    pc.has_error = true;
+                    pc.error = e.what();
+                }
+                if ( ! pc.has_error && pc.cmd.op == Command::QUIT)
+                    return false;
+                batch.push_back(pc);
+            }
+            return true;
+        }
+        bool is_read_only(size_t i) const {
+            return ! batch[i].has_error && Driver::is_read_only(batch[i].cmd);
+        }
+        void run_one(ParsedCommand const& pc, TextSink& sink, bool read_only) {
+            try {
+                if (pc.has_error)
+                    throw std::invalid_argument(pc.error);
+                if (read_only)
+                    driver.execute_read_only(pc.cmd, sink);
+                else
+                    driver.execute(pc.cmd, sink);
+            } catch (std::exception& e) {
+                sink.out << "Exception: " << e.what() << '\n';
+            }
+        }
+        void run_reads_in_parallel(size_t start, size_t end, std::ostream& out) {
+            //split the run into a few tasks per thread, so a slow task doesn't leave the rest of the pool idle
+            size_t num_commands = end - start;
+            size_t num_tasks = std::min(pool.num_threads() * 4, num_commands / min_commands_per_task);
+            size_t per_task = (num_commands + num_tasks - 1) / num_tasks;
+            if (task_outputs.size() < num_tasks)
+                task_outputs.resize(num_tasks);
+            pool.run(num_tasks, [this, start, end, per_task](size_t t) {
+                std::ostringstream& task_out = task_outputs[t];
+                task_out.str("");
+                TextSink sink(task_out);
+                size_t task_end = std::min(end, start + (t + 1) * per_task);
+                uint64_t ids[Driver::max_count_batch];
+                for (size_t i = start + t * per_task; i < task_end; ) {
+                    //consecutive counts go to the tree together, so their lookups can overlap
+                    size_t num_counts = 0;
+                    while (i + num_counts < task_end && num_counts != Driver::max_count_batch
+                           && batch[i + num_counts].cmd.op == Command::COUNT) {
+                        ids[num_counts] = batch[i + num_counts].cmd.args[0];
+                        ++num_counts;
+                    }
+                    if (num_counts > 1) {
+                        driver.count_batch(ids, num_counts, sink);
+                        i += num_counts;
+                    } else {
+                        run_one(batch[i], sink, true);
+                        ++i;
+                    }
+                }
+            });
+            for (size_t t = 0; t != num_tasks; ++t)
+                out << task_outputs[t].str();
+        }
+        void run_batch(std::ostream& out) {
+            TextSink sink(out);
+            for (size_t i = 0; i < batch.size(); ) {
+                size_t run_end = i;
+                while (run_end < batch.size() && is_read_only(run_end))
+                    ++run_end;
+                if (run_end - i >= 2 * min_commands_per_task && pool.num_threads() > 1) {
+                    run_reads_in_parallel(i, run_end, out);
+                    i = run_end;
+                    continue;
+                }
+                //too short to be worth spreading out, or a command that modifies the counter
+                for (size_t last = std::max(run_end, i + 1); i < last; ++i)
+                    run_one(batch[i], sink, i < run_end);
+            }
+        }
+    public:
+        BasicBatchRunner(Driver& driver, size_t num_threads): driver(driver), pool(num_threads) {}
+        /*
+            Run every command from in until quit or the end of input, writing the responses to out.
+        */
+        void run(std::istream& in, std::ostream& out) {
+            bool more = true;
+            while (more) {
+                more = read_batch(in);
+                run_batch(out);
+                out.flush();
+            }
+        }
+    };
+
+    typedef BasicBatchRunner<Driver> BatchRunner;
+}
+
+#endif
@@ -0,0 +1,191 @@
+#ifndef _BINARY_PROTOCOL_H_
+#define _BINARY_PROTOCOL_H_
+
+#include <cstdlib>
+#include <cstdint>
+#include <string>
+#include "command.h"
+#include "event_counter.h"
+
+namespace cop5536 {
+    /*
+        The binary command format is a stream of records, each an opcode byte followed by that opcode's
+        arguments as LEB128 varints (7 bits per byte, low bits first, high bit set on every byte but the last),
+        so small IDs and counts take one or two bytes. Responses are varints too:
+            increase, reduce, count, total     value
+            next, previous                     id count
+            inrange                            chunks of counts, then 0, or 1 and the ID to resume from
+            topk                               n, n pairs of id count
+            nextn                              chunks of id count pairs
+        A range can be far longer than anything worth buffering, so inrange and nextn write their items as the
+        cursor reaches them, in chunks: each chunk is n (at most items_per_chunk), then n items, and a chunk
+        with n = 0 ends the list.
+    */
+    namespace binary_protocol {
+        static const size_t items_per_chunk = 256;
+
+        inline void put_varint(std::string& out, uint64_t v) {
+            while (v >= 0x80) {
+                out.push_back(static_cast<char>((v & 0x7f) | 0x80));
+                v >>= 7;
+            }
+            out.push_back(static_cast<char>(v));
+        }
+
+        /*
+            Read a varint at p, moving p past it. Returns false if the input ends first or the varint is too long.
+        */
+        inline bool get_varint(const char*& p, const char* end, uint64_t& v) {
+            v = 0;
+            for (unsigned shift = 0; shift < 64 && p != end; shift += 7) {
+                uint8_t byte = static_cast<uint8_t>(*p++);
+                v |= static_cast<uint64_t>(byte & 0x7f) << shift;
+                if ( ! (byte & 0x80))
+                    return true;
+            }
+            return false;
+        }
+
+        inline void encode_command(Command const& cmd, std::string& out) {
+            out.push_back(static_cast<char>(cmd.op));
+            for (size_t i = 0; i != Command::num_args(cmd.op); ++i)
+                put_varint(out, cmd.args[i]);
+        }
+
+        /*
+            Decode the record at p, moving p past it. Returns false at the end of the input or on a malformed record.
+        */
+        inline bool decode_command(const char*& p, const char* end, Command& cmd) {
+            if (p == end)
+                return false;
+            uint8_t op = static_cast<uint8_t>(*p++);
+            if (op == Command::INVALID || op > Command::TOTAL)
+                return false;
+            cmd.op = static_cast<Command::Opcode>(op);
+            for (size_t i = 0; i != Command::num_args(cmd.op); ++i)
+                if ( ! get_varint(p, end, cmd.args[i]))
+                    return false;
+            return true;
+        }
+
+        class ChunkWriter {
+        /*
+            Writes a list of items to out in chunks, as described above, holding back at most one chunk.
+        */
+        private:
+            std::string& out;
+            std::string chunk;
+            size_t num_items;
+            void flush() {
+                put_varint(out, num_items);
+                out += chunk;
+                chunk.clear();
+                num_items = 0;
+            }
+        public:
+            ChunkWriter(std::string& out): out(out), num_items(0) {}
+            /*
+                Return the string to append the next item's varints to.
+            */
+            std::string& next_item() {
+                if (num_items == items_per_chunk)
+                    flush();
+                ++num_items;
+                return chunk;
+            }
+            /*
+                Write out the last chunk, and the empty chunk that ends the list.
+            */
+            void finish() {
+                if (num_items != 0)
+                    flush();
+                put_varint(out, 0);
+            }
+        };
+
+        /*
+            Read a chunked list, as ChunkWriter wrote it, calling read_item(p, end) once per item to read its
+            varints. Returns false if the input ends first.
+        */
+        template <typename ReadItem>
+        bool read_chunks(const char*& p, const char* end, ReadItem read_item) {
+            while (true) {
+                uint64_t n;
+                if ( ! get_varint(p, end, n))
+                    return false;
+                if (n == 0)
+                    return true;
+                for (uint64_t i = 0; i != n; ++i)
+                    if ( ! read_item(p, end))
+                        return false;
+            }
+        }
+
+        /*
+            Apply a command straight to a counter and append its binary response. Commands that need the driver's
+            windowed mode (timestamped increase, tick) are not supported here and return false, as does quit.
+        */
+        inline bool execute(EventCounter& ec, Command const& cmd, std::string& out) {
+            uint64_t const* a = cmd.args;
+            switch (cmd.op) {
+            case Command::INCREASE:
+                put_varint(out, ec.increase(a[0], a[1]));
+                return true;
+            case Command::REDUCE:
+                put_varint(out, ec.reduce(a[0], a[1]));
+                return true;
+            case Command::COUNT:
+                put_varint(out, ec.count(a[0]));
+                return true;
+            case Command::TOTAL:
+                put_varint(out, ec.total(a[0], a[1]));
+                return true;
+            case Command::NEXT:
+            case Command::PREVIOUS: {
+                EventCounter::kv_pair match = cmd.op == Command::NEXT ? ec.next(a[0]) : ec.previous(a[0]);
+                put_varint(out, match.first);
+                put_varint(out, match.second);
+                return true;
+            }
+            case Command::INRANGE:
+            case Command::INRANGE_LIMIT: {
+                uint64_t limit = cmd.op == Command::INRANGE_LIMIT ? a[2] : UINT64_MAX;
+                EventCounter::RangeCursor cursor = ec.range(a[0], a[1]);
+                ChunkWriter chunks(out);
+                for (; cursor.valid() && limit != 0; cursor.advance(), --limit)
+                    put_varint(chunks.next_item(), cursor.value());
+                chunks.finish();
+                put_varint(out, cursor.valid() ? 1 : 0);
+                if (cursor.valid())
+                    put_varint(out, cursor.key());
+                return true;
+            }
+            case Command::TOPK: {
+                EventCounter::kv_list top;
+                ec.top_k(a[0], a[1], a[2], top);
+                put_varint(out, top.size());
+                for (EventCounter::kv_pair const& kv: top) {
+                    put_varint(out, kv.first);
+                    put_varint(out, kv.second);
+                }
+                return true;
+            }
+            case Command::NEXTN: {
+                uint64_t n = a[1];
+                ChunkWriter chunks(out);
+                for (EventCounter::RangeCursor cursor = ec.after(a[0]); cursor.valid() && n != 0; cursor.advance(), --n) {
+                    std::string& item = chunks.next_item();
+                    put_varint(item, cursor.key());
+                    put_varint(item, cursor.value());
+                }
+                chunks.finish();
+                return true;
+            }
+            default:
+                return false;
+            }
+        }
+    }
+}
+
+#endif
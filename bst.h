@@ -7,6 +7,20 @@
 #include <stdexcept>
 #include <cmath>
 #include <set>
+#include <string>
+#include "node_arena.h"
+
+//with _DEBUG_ on, every insert and remove checks the nodes it may have changed, and on average one in this many
+//checks the whole tree as well; 0 means one in size(), which keeps the full checks to O(1) amortized time
+#ifndef _FULL_CHECK_INTERVAL_
+#define _FULL_CHECK_INTERVAL_ 0
+#endif
+
+//with _INORDER_LINKS_ on, every node also links to its in-order neighbours, so stepping to the next or previous key
+//takes O(1) time instead of a descent, at the cost of two more words per node; off by default
+#ifndef _INORDER_LINKS_
+#define _INORDER_LINKS_ 0
+#endif
 
 namespace cop5536 {
     class BST {
@@ -24,32 +38,17 @@ namespace cop5536 {
             size_t left_index;
             size_t right_index;
             size_t height; //height-tracking so we can look that value up in O(1) time
+            value_type max_value; //largest value in this subtree, so heavy subtrees can be found without visiting them
+#if _INORDER_LINKS_
+            size_t next_index; //in-order successor, or 0 for the largest key; rotations don't change key order, so
+            size_t prev_index; //these links only change when a node is added or removed
+#endif
             bool is_occupied;
-            Node(): num_children(0), left_index(0), right_index(0), height(0), is_occupied(0) {}
-            size_t validate_children_count_recursive(Node* nodes) {
-                //this function is for debugging purposes, does recursive traversal to find the correct number of children
-                size_t child_count = 0;
-                if (left_index)
-                    child_count += 1 + nodes[left_index].validate_children_count_recursive(nodes);
-                if (right_index)
-                    child_count += 1 + nodes[right_index].validate_children_count_recursive(nodes);
-                if (child_count != num_children) {
-                    std::ostringstream msg;
-                    msg << "Manually counted children, " << child_count << ", different than child count, " << num_children;
-                    throw std::logic_error(msg.str());
-                }
-                return child_count;
-            }
-            size_t get_height_recursive(Node* nodes) {
-                //this function is for debugging purposes, does recursive traversal to find the correct height
-                size_t left_height = 0, right_height = 0;
-                size_t calculated_height = 0;
-                if (left_index)
-                    left_height = nodes[left_index].get_height_recursive(nodes);
-                if (right_index)
-                    right_height = nodes[right_index].get_height_recursive(nodes);
-                calculated_height = 1 + std::max(left_height, right_height);
-                return calculated_height;
+            uint8_t rank_diffs; //rank-balanced trees only: bit 0 (1) is set if the left (right) child's rank is two below this node's, rather than one
+            Node(): num_children(0), left_index(0), right_index(0), height(0), max_value(0), is_occupied(0), rank_diffs(0) {
+#if _INORDER_LINKS_
+                next_index = prev_index = 0;
+#endif
             }
             void update_height(Node* nodes) {
                 //note: this method depends on the left and right subtree heights being correct
@@ -59,29 +58,39 @@ namespace cop5536 {
                 if (right_index)
                     right_height = nodes[right_index].height;
                 height = 1 + std::max(left_height, right_height);
-                if (_DEBUG_) {
-                    size_t calculated_height = get_height_recursive(nodes);
-                    if (calculated_height != height) {
-                        std::ostringstream msg;
-                        msg << "Manually calculated height, " << calculated_height << ", different than tracked height, " << height;
-                        throw std::logic_error(msg.str());
-                    }
-                }
+            }
+            void update_max_value(Node* nodes) {
+                //note: this method depends on the left and right subtree max values being correct
+                max_value = value;
+                if (left_index)
+                    max_value = std::max(max_value, nodes[left_index].max_value);
+                if (right_index)
+                    max_value = std::max(max_value, nodes[right_index].max_value);
             }
             void disable_and_adopt_free_tree(size_t free_index) {
                 is_occupied = false;
                 height = 0;
+                max_value = 0;
                 num_children = 0;
                 right_index = 0;
+#if _INORDER_LINKS_
+                next_index = prev_index = 0;
+#endif
+                rank_diffs = 0;
                 left_index = free_index;
             }
             void reset_and_enable(key_type const& new_key, value_type const& new_value) {
                 is_occupied = true;
                 height = 1; //self
                 left_index = right_index = 0;
+#if _INORDER_LINKS_
+                next_index = prev_index = 0;
+#endif
+                rank_diffs = 0; //a new node is a leaf, one rank above each of its missing children
                 num_children = 0;
                 key = new_key;
                 value = new_value;
+                max_value = new_value;
             }
             int balance_factor(const Node* nodes) const {
                 size_t left_height = 0, right_height = 0;
@@ -92,10 +101,13 @@ namespace cop5536 {
                 return static_cast<long int>(left_height) - static_cast<long int>(right_height);
             }
         };
+        NodeArena<Node> arena; //holds nodes; slot 0 is the shared null child
         Node* nodes; //***note: array is 1-based so leaf nodes have child indices set to zero
-        size_t free_index;
+        size_t free_index; //first slot of the free list of removed nodes, or 0 if it is empty
+        size_t num_used_slots; //slots past this one have never held a node, and are free without being on the free list
         size_t root_index;
-        size_t curr_capacity;
+        size_t num_top_slots; //slots set aside at the front of the array for the top levels of a sorted build
+        static const size_t max_top_slots = 4095; //the top 12 levels, about 320 KB
         virtual size_t remove_smallest_key_node_index(size_t& subtree_root_index) {
             //returns the index of the node with the smallest key, while
             //setting its parent's left child index to the smallest key node's
@@ -110,6 +122,7 @@ namespace cop5536 {
                     smallest_key_node_index = remove_smallest_key_node_index(subtree_root.left_index);
                     subtree_root.num_children--;
                     subtree_root.update_height(nodes);
+                    subtree_root.update_max_value(nodes);
                 } else {
                     smallest_key_node_index = subtree_root_index;
                     subtree_root_index = subtree_root.right_index;
@@ -131,6 +144,7 @@ namespace cop5536 {
                     largest_key_node_index = remove_largest_key_node_index(subtree_root.right_index);
                     subtree_root.num_children--;
                     subtree_root.update_height(nodes);
+                    subtree_root.update_max_value(nodes);
                 } else {
                     largest_key_node_index = subtree_root_index;
                     subtree_root_index = subtree_root.left_index;
@@ -159,10 +173,13 @@ namespace cop5536 {
                 //updating the heights of the old root's relevant subtrees (which the new root
                 //just adopted), so we can update the new root's height now
                 new_root.update_height(nodes);
+                new_root.update_max_value(nodes);
             } else
                 //neither subtree exists, so just delete the node
                 subtree_root_index = 0;
-            //node has been disowned by all ancestors, and has disowned all descendents, so free it
+            //node has been disowned by all ancestors, and has disowned all descendents, so drop it from the
+            //in-order links and free it
+            unlink(index_to_delete);
             add_node_to_free_tree(index_to_delete);
         }
         virtual int do_remove(size_t nodes_visited, //starts at 0 when this function is first called (ie does not include current node visitation)
@@ -182,6 +199,7 @@ namespace cop5536 {
                         subtree_root.num_children--;
                         //left child changed, so recompute subtree height
                         subtree_root.update_height(nodes);
+                        subtree_root.update_max_value(nodes);
                     }
                 } else if (key > subtree_root.key) {
                     nodes_visited = do_remove(nodes_visited, subtree_root.right_index, key, value, found_key);
@@ -190,6 +208,7 @@ namespace cop5536 {
                         subtree_root.num_children--;
                         //right child changed, so recompute subtree height
                         subtree_root.update_height(nodes);
+                        subtree_root.update_max_value(nodes);
                     }
                 } else if (key == subtree_root.key) {
                     //found key, remove the node
@@ -202,17 +221,226 @@ namespace cop5536 {
             }
             return nodes_visited;
         }
+        //the three link helpers below do nothing unless _INORDER_LINKS_ is on, so the engines can call them either way
+        void link_before(size_t node_index, size_t new_index) {
+            //splice a new node into the in-order links just ahead of node_index
+#if _INORDER_LINKS_
+            Node& n = nodes[node_index];
+            nodes[new_index].prev_index = n.prev_index;
+            nodes[new_index].next_index = node_index;
+            if (n.prev_index)
+                nodes[n.prev_index].next_index = new_index;
+            n.prev_index = new_index;
+#endif
+        }
+        void link_after(size_t node_index, size_t new_index) {
+            //splice a new node into the in-order links just behind node_index
+#if _INORDER_LINKS_
+            Node& n = nodes[node_index];
+            nodes[new_index].next_index = n.next_index;
+            nodes[new_index].prev_index = node_index;
+            if (n.next_index)
+                nodes[n.next_index].prev_index = new_index;
+            n.next_index = new_index;
+#endif
+        }
+        void unlink(size_t node_index) {
+#if _INORDER_LINKS_
+            Node& n = nodes[node_index];
+            if (n.prev_index)
+                nodes[n.prev_index].next_index = n.next_index;
+            if (n.next_index)
+                nodes[n.next_index].prev_index = n.prev_index;
+#endif
+        }
+        size_t next_in_order(size_t node_index) const {
+            //the node with the next key up from node_index's, or 0 if it holds the largest key
+#if _INORDER_LINKS_
+            return nodes[node_index].next_index;
+#else
+            size_t found_index = 0;
+            for (size_t i = root_index; i != 0; ) {
+                if (nodes[node_index].key < nodes[i].key) {
+                    found_index = i;
+                    i = nodes[i].left_index;
+                } else {
+                    i = nodes[i].right_index;
+                }
+            }
+            return found_index;
+#endif
+        }
+        size_t previous_in_order(size_t node_index) const {
+            //mirror image of next_in_order
+#if _INORDER_LINKS_
+            return nodes[node_index].prev_index;
+#else
+            size_t found_index = 0;
+            for (size_t i = root_index; i != 0; ) {
+                if (nodes[i].key < nodes[node_index].key) {
+                    found_index = i;
+                    i = nodes[i].right_index;
+                } else {
+                    i = nodes[i].left_index;
+                }
+            }
+            return found_index;
+#endif
+        }
+        void validate_links() const {
+            //this function is for debugging purposes, walks the in-order links and checks them against the tree
+#if _INORDER_LINKS_
+            size_t expected_size = size(), num_linked = 0, prev = 0;
+            size_t i = root_index;
+            while (i && nodes[i].left_index)
+                i = nodes[i].left_index;
+            for (; i != 0; prev = i, i = nodes[i].next_index, ++num_linked) {
+                if (nodes[i].prev_index != prev || (prev && nodes[prev].key >= nodes[i].key) || num_linked > expected_size)
+                    throw std::logic_error("In-order links out of order or out of sync with the tree");
+            }
+            if (num_linked != expected_size) {
+                std::ostringstream msg;
+                msg << "Walked " << num_linked << " linked nodes, but the tree holds " << expected_size;
+                throw std::logic_error(msg.str());
+            }
+#endif
+        }
+        virtual void validate_balance(size_t node_index) const {
+            //this function is for debugging purposes, checks the node's balancing information against its children
+            //only; engines override it with their own balance rules
+            Node const& n = nodes[node_index];
+            size_t calculated_height = 1 + std::max(nodes[n.left_index].height, nodes[n.right_index].height);
+            if (calculated_height != n.height) {
+                std::ostringstream msg;
+                msg << "Calculated height, " << calculated_height << ", different than tracked height, " << n.height;
+                throw std::logic_error(msg.str());
+            }
+        }
+        void validate_node(size_t node_index, size_t below_index, size_t above_index) const {
+            //this function is for debugging purposes, checks a node against its children, its in-order neighbours,
+            //and the nearest ancestors it should sort after (below_index) and before (above_index), in O(1) time
+            //(plus whatever validate_balance takes)
+            if (node_index == 0)
+                return;
+            Node const& n = nodes[node_index];
+            if ( ! n.is_occupied)
+                throw std::logic_error("Found a free node in the tree");
+            if ((below_index && ! (nodes[below_index].key < n.key)) || (above_index && ! (n.key < nodes[above_index].key)))
+                throw std::logic_error("Key out of order with its ancestors");
+            size_t child_count = 0;
+            if (n.left_index)
+                child_count += 1 + nodes[n.left_index].num_children;
+            if (n.right_index)
+                child_count += 1 + nodes[n.right_index].num_children;
+            if (child_count != n.num_children) {
+                std::ostringstream msg;
+                msg << "Counted children, " << child_count << ", different than child count, " << n.num_children;
+                throw std::logic_error(msg.str());
+            }
+            if (n.max_value != std::max(n.value, std::max(nodes[n.left_index].max_value, nodes[n.right_index].max_value)))
+                throw std::logic_error("Subtree max value out of sync with its children");
+#if _INORDER_LINKS_
+            if ((n.next_index && nodes[n.next_index].prev_index != node_index) || (n.prev_index && nodes[n.prev_index].next_index != node_index))
+                throw std::logic_error("In-order links out of sync with their neighbours");
+#endif
+            validate_balance(node_index);
+        }
+        void validate_path(key_type const& key, size_t& below_index, size_t& above_index) const {
+            //this function is for debugging purposes, checks every node on the search path to key along with its
+            //children, in O(log N) time; on return, below_index and above_index are the nodes with the nearest keys
+            //below key and at or above it
+            below_index = above_index = 0;
+            validate_node(root_index, 0, 0);
+            for (size_t i = root_index; i != 0; ) {
+                Node const& n = nodes[i];
+                validate_node(n.left_index, below_index, i);
+                validate_node(n.right_index, i, above_index);
+                if (key < n.key) {
+                    above_index = i;
+                    i = n.left_index;
+                } else if (n.key < key) {
+                    below_index = i;
+                    i = n.right_index;
+                } else {
+                    above_index = i;
+                    below_index = previous_in_order(i);
+                    break;
+                }
+            }
+        }
+        void validate_subtree(size_t subtree_root_index, size_t below_index, size_t above_index) const {
+            if (subtree_root_index == 0)
+                return;
+            validate_node(subtree_root_index, below_index, above_index);
+            validate_subtree(nodes[subtree_root_index].left_index, below_index, subtree_root_index);
+            validate_subtree(nodes[subtree_root_index].right_index, subtree_root_index, above_index);
+        }
+        void validate_tree() const {
+            //this function is for debugging purposes, checks every node, in O(N) time (plus whatever
+            //validate_balance takes)
+            validate_subtree(root_index, 0, 0);
+            validate_links();
+        }
+        bool is_full_check_due() const {
+            //decide at random whether this update gets a full check, which on average one in
+            //_FULL_CHECK_INTERVAL_ updates do, or one in size() if that is 0
+            static uint64_t state = 0x9e3779b97f4a7c15;
+            state ^= state << 13;
+            state ^= state >> 7;
+            state ^= state << 17;
+            size_t interval = _FULL_CHECK_INTERVAL_ != 0 ? _FULL_CHECK_INTERVAL_ : std::max<size_t>(1, size());
+            return state % interval == 0;
+        }
+        void validate_after_insert(key_type const& key) const {
+            //this function is for debugging purposes: an insert only changes nodes on the search path to the new
+            //key and their children, so those are checked every time, and the whole tree now and then
+            size_t below_index, above_index;
+            validate_path(key, below_index, above_index);
+            if (is_full_check_due())
+                validate_tree();
+        }
+        void validate_after_remove(key_type const& key) const {
+            //this function is for debugging purposes: a removal also changes the nodes around where the removed
+            //key's successor (or predecessor) was taken from, deeper down, which the search paths to the keys
+            //next to those pass through
+            size_t below_index, above_index, unused_below, unused_above;
+            validate_path(key, below_index, above_index);
+            if (below_index) {
+                validate_path(nodes[below_index].key, unused_below, unused_above);
+                if (size_t previous_index = previous_in_order(below_index))
+                    validate_path(nodes[previous_index].key, unused_below, unused_above);
+            }
+            if (above_index) {
+                validate_path(nodes[above_index].key, unused_below, unused_above);
+                if (size_t next_index = next_in_order(above_index))
+                    validate_path(nodes[next_index].key, unused_below, unused_above);
+            }
+            if (is_full_check_due())
+                validate_tree();
+        }
         void add_node_to_free_tree(size_t node_index) {
             nodes[node_index].disable_and_adopt_free_tree(free_index);
             nodes[node_index].num_children = 1 + nodes[nodes[node_index].left_index].num_children;
             free_index = node_index;
         }
+        void release() {
+            //forget the node array, which has been handed to another tree
+            nodes = nullptr;
+            free_index = 0;
+            num_used_slots = 0;
+            root_index = 0;
+            num_top_slots = 0;
+        }
         size_t procure_node(key_type const& key, value_type const& value) {
-            //updates the free index to the first free node's left child (while transforming that first free
-            //node to an enabled node with the specified key/value) and returns the index of what was the last
-            //free index
-            size_t node_index = free_index;
-            free_index = nodes[free_index].left_index;
+            //takes the first node off the free list, or if that is empty the first never-used slot, transforms
+            //it to an enabled node with the specified key/value, and returns its index
+            size_t node_index;
+            if (free_index != 0) {
+                node_index = free_index;
+                free_index = nodes[free_index].left_index;
+            } else {
+                node_index = ++num_used_slots;
+            }
             Node& n = nodes[node_index];
             n.reset_and_enable(key, value);
             return node_index;
@@ -232,22 +460,35 @@ namespace cop5536 {
                 Node& subtree_root = nodes[subtree_root_index];
                 ++nodes_visited;
                 if (key < subtree_root.key) {
+                    bool is_parent = subtree_root.left_index == 0;
                     nodes_visited = insert_at_leaf(nodes_visited, subtree_root.left_index, key, value, found_key);
                     if ( ! found_key) {
                         //given key is unique to the tree, so a new node was added
                         subtree_root.num_children++;
                         subtree_root.update_height(nodes);
+                        //a new left leaf comes right before its parent in key order
+                        if (is_parent)
+                            link_before(subtree_root_index, subtree_root.left_index);
                     }
+                    //either a node was added or a value was replaced below, so the subtree max may have changed
+                    subtree_root.update_max_value(nodes);
                 } else if (key > subtree_root.key) {
+                    bool is_parent = subtree_root.right_index == 0;
                     nodes_visited = insert_at_leaf(nodes_visited, subtree_root.right_index, key, value, found_key);
                     if ( ! found_key) {
                         //given key is unique to the tree, so a new node was added
                         subtree_root.num_children++;
                         subtree_root.update_height(nodes);
+                        //a new right leaf comes right after its parent in key order
+                        if (is_parent)
+                            link_after(subtree_root_index, subtree_root.right_index);
                     }
+                    //either a node was added or a value was replaced below, so the subtree max may have changed
+                    subtree_root.update_max_value(nodes);
                 } else if (key == subtree_root.key) {
                     //found key, replace the value
                     subtree_root.value = value;
+                    subtree_root.update_max_value(nodes);
                     found_key = true;
                 } else {
                     throw std::logic_error("Unexpected compare result");
@@ -279,63 +520,169 @@ namespace cop5536 {
             return nodes_visited;
         }
         void increase_capacity() {
-            size_t old_capacity = capacity(),
-                new_capacity = old_capacity * 2;
-            Node* new_nodes = new Node[new_capacity + 1];
-            //copy the old tree to the new array
-            for (size_t i = 1; i <= old_capacity; ++i)
-                new_nodes[i] = nodes[i];
-            //delete the old tree and set the pointer to the new array
-            delete[] nodes;
-            nodes = new_nodes;
-            curr_capacity = new_capacity;
-            //fill the free tree with the new, unused nodes
-            free_index = old_capacity + 1;
-            for (size_t i = free_index; i != new_capacity; ++i)
-                nodes[i].disable_and_adopt_free_tree(i + 1);
+            //the arena grows in place where it can, and the new slots are never-used ones, so nothing is
+            //copied or chained up
+            arena.resize(std::max<size_t>(1, capacity() * 2) + 1);
+            nodes = arena.data();
+        }
+        size_t move_node(size_t from_index, size_t to_index) {
+            //move a node to an unused slot, fixing up its in-order neighbours' links, and free the slot it was
+            //in; the caller fixes up the link from its parent
+            nodes[to_index] = nodes[from_index];
+#if _INORDER_LINKS_
+            Node& n = nodes[to_index];
+            if (n.prev_index)
+                nodes[n.prev_index].next_index = to_index;
+            if (n.next_index)
+                nodes[n.next_index].prev_index = to_index;
+#endif
+            add_node_to_free_tree(from_index);
+            return to_index;
+        }
+        void move_top_levels_to_front() {
+            //move the nodes at the top of the tree, breadth first, into the slots set aside for them at the front
+            //of the array, so every descent starts on the same few pages; the filled slots double as the queue
+            size_t next_slot = 1;
+            if (root_index != 0 && num_top_slots != 0)
+                root_index = move_node(root_index, next_slot++);
+            for (size_t i = 1; i != next_slot; ++i) {
+                Node& n = nodes[i];
+                if (n.left_index && next_slot <= num_top_slots)
+                    n.left_index = move_node(n.left_index, next_slot++);
+                if (n.right_index && next_slot <= num_top_slots)
+                    n.right_index = move_node(n.right_index, next_slot++);
+            }
+            //fewer pairs than expected turned up
+            for (; next_slot <= num_top_slots; ++next_slot)
+                add_node_to_free_tree(next_slot);
         }
         /*
-        start_idx is inclusive
-        end_idx is exclusive
-        return the new index of subtree root in the nodes array
+        turns slots start_idx (inclusive) through end_idx (exclusive), which hold consecutive keys in ascending
+        order, into a height-balanced subtree by making the middle slot its root
+        return the index of the subtree root in the nodes array
         */
-        virtual size_t init_from_kv_list(const kv_list& init_kvs, const size_t start_idx, const size_t end_idx) {
+        virtual size_t init_from_sorted_slots(const size_t start_idx, const size_t end_idx) {
             if (start_idx == end_idx)
                 return 0;
-            size_t root_src_idx = (end_idx + start_idx) / 2;
-            kv_pair kv = init_kvs[root_src_idx];
-            size_t root_dst_idx = procure_node(kv.first, kv.second);
-            Node& n = nodes[root_dst_idx];
-            n.left_index = init_from_kv_list(init_kvs, start_idx, root_src_idx);
+            size_t root_idx = (end_idx + start_idx) / 2;
+            Node& n = nodes[root_idx];
+            n.left_index = init_from_sorted_slots(start_idx, root_idx);
             if (n.left_index)
                 n.num_children = 1 + nodes[n.left_index].num_children;
-            n.right_index = init_from_kv_list(init_kvs, root_src_idx + 1, end_idx);
+            n.right_index = init_from_sorted_slots(root_idx + 1, end_idx);
             if (n.right_index)
                 n.num_children += 1 + nodes[n.right_index].num_children;
-            if (_DEBUG_)
-                n.validate_children_count_recursive(nodes);
             n.height = 1 + std::max(nodes[n.left_index].height, nodes[n.right_index].height);
-            return root_dst_idx;
+            n.update_max_value(nodes);
+            return root_idx;
+        }
+        void build_from_kv_list(const kv_list& init_kvs) {
+            start_sorted_build(init_kvs.size());
+            for (kv_pair const& kv: init_kvs)
+                add_sorted(kv.first, kv.second);
+            finish_sorted_build();
         }
     public:
         /*
             The constructor will allocate an array of capacity (binary
-            tree) nodes. Then make a chain from all the nodes (e.g.,
-            make node 2 the left child of node 1, make node 3 the left
-            child of node 2, &c. this is the initial free list.
+            tree) nodes. None of them has been used yet, so the free list
+            starts out empty: new nodes are taken from the never-used slots
+            in order (node 1, then node 2, &c.) until removed nodes turn up
+            on the free list.
         */
-        BST(size_t init_capacity):
-            curr_capacity(init_capacity)
-        {
+        BST(size_t init_capacity) {
             if (init_capacity == 0) {
                 throw std::domain_error("init_capacity must be at least 1");
             }
             //in an ideal world we'd use something like a vector here, but we don't live in a perfect world; we live in a Hillary vs. Trump world
-            nodes = new Node[init_capacity + 1];
+            arena.reset(init_capacity + 1);
+            nodes = arena.data();
             clear();
         }
-        BST(const kv_list& init_kvs): BST(init_kvs.size() * 2) {
-            root_index = init_from_kv_list(init_kvs, 0, init_kvs.size());
+        BST(const kv_list& init_kvs): BST(std::max<size_t>(1, init_kvs.size())) {
+            build_from_kv_list(init_kvs);
+        }
+        /*
+            The tree owns its node array, so it can be moved but not copied. A tree that has been moved
+            from is left empty, with no node array until something is inserted into it.
+        */
+        BST(BST const&) = delete;
+        BST& operator=(BST const&) = delete;
+        BST(BST&& other):
+            arena(std::move(other.arena)), nodes(other.nodes), free_index(other.free_index),
+            num_used_slots(other.num_used_slots), root_index(other.root_index), num_top_slots(other.num_top_slots)
+        {
+            other.release();
+        }
+        BST& operator=(BST&& other) {
+            if (this != &other) {
+                arena = std::move(other.arena);
+                nodes = other.nodes;
+                free_index = other.free_index;
+                num_used_slots = other.num_used_slots;
+                root_index = other.root_index;
+                num_top_slots = other.num_top_slots;
+                other.release();
+            }
+            return *this;
+        }
+        virtual ~BST() {}
+        /*
+            Keep the node array in a new file at path, or in a directory path, rather than in memory, from now
+            on; see NodeArena. The tree can then grow well past physical memory, at the cost of a page fault for
+            every node visited that has been evicted.
+        */
+        void back_with_file(std::string const& path) {
+            arena.back_with_file(path);
+            nodes = arena.data();
+        }
+        /*
+            Empty the tree, and size its node array for exactly expected_size items, to be filled by calling
+            add_sorted for every key/value-pair in ascending key order, and then finish_sorted_build. The
+            pairs go straight into the array in key order, so nothing else needs to hold them meanwhile, and
+            finish_sorted_build links them up into a balanced tree in O(N) time. If more pairs turn up than
+            expected, the array grows as it would for insert.
+
+            Once built, the top levels of the tree are moved together to the front of the array. For a
+            file-backed tree, the front is then locked in memory (best effort), and the rest of the array is
+            marked for random access, as that is how descents will visit it.
+        */
+        void start_sorted_build(size_t expected_size) {
+            num_top_slots = expected_size < max_top_slots ? expected_size : max_top_slots;
+            arena.reset(std::max<size_t>(1, num_top_slots + expected_size) + 1);
+            nodes = arena.data();
+            if (arena.is_file_backed())
+                arena.set_access(NodeArena<Node>::SEQUENTIAL);
+            //while building, slots (num_top_slots, num_used_slots] hold the pairs added so far
+            free_index = 0;
+            num_used_slots = num_top_slots;
+            root_index = 0;
+        }
+        void add_sorted(key_type const& key, value_type const& value) {
+            if (num_used_slots == capacity())
+                increase_capacity();
+            size_t node_index = ++num_used_slots;
+            bool is_first = node_index == num_top_slots + 1;
+            if ( ! is_first && key <= nodes[node_index - 1].key)
+                throw std::domain_error("Keys must be added in ascending order, without duplicates");
+            nodes[node_index].reset_and_enable(key, value);
+#if _INORDER_LINKS_
+            //slots are in key order, so the neighbouring slots are the in-order neighbours
+            if ( ! is_first) {
+                nodes[node_index].prev_index = node_index - 1;
+                nodes[node_index - 1].next_index = node_index;
+            }
+#endif
+        }
+        void finish_sorted_build() {
+            root_index = init_from_sorted_slots(num_top_slots + 1, num_used_slots + 1);
+            move_top_levels_to_front();
+            if (_DEBUG_)
+                validate_tree();
+            if (arena.is_file_backed()) {
+                arena.set_access(NodeArena<Node>::RANDOM);
+                arena.keep_resident(num_top_slots + 1);
+            }
         }
         /*
             Adds the specified key/value-pair to the tree and returns the number of
@@ -352,7 +699,7 @@ namespace cop5536 {
             value_type v(value);
             int nodes_visited = insert_at_leaf(0, root_index, k, v, found_key);
             if (_DEBUG_)
-                this->nodes[this->root_index].validate_children_count_recursive(this->nodes);
+                validate_after_insert(key);
             return nodes_visited;
         }
         /*
@@ -367,7 +714,7 @@ namespace cop5536 {
             value_type v(value);
             int nodes_visited = do_remove(0, root_index, k, v, found_key);
             if (_DEBUG_)
-                this->nodes[this->root_index].validate_children_count_recursive(this->nodes);
+                validate_after_remove(key);
             if (found_key)
                 value = v;
             return found_key ? nodes_visited : -1 * nodes_visited;
@@ -376,7 +723,7 @@ namespace cop5536 {
             if there is an item matching key, stores it's value in value, and returns the number
             of nodes visited, V; otherwise returns -1 * V. Regardless, the item remains in the tree.
         */
-        virtual int search(key_type const& key, value_type& value) {
+        virtual int search(key_type const& key, value_type& value) const {
             if (is_empty())
                 return 0;
             bool found_key = false;
@@ -393,10 +740,11 @@ namespace cop5536 {
         virtual void clear() {
             //Since I use size_t to hold the node indices, I make the node array
             //1-based, with child index of 0 indicating that the current node is a leaf
-            for (size_t i = 1; i != capacity(); ++i)
-                nodes[i].disable_and_adopt_free_tree(i + 1);
-            free_index = 1;
+            //every slot goes back to being never-used, so nothing needs to be chained up
+            free_index = 0;
+            num_used_slots = 0;
             root_index = 0;
+            num_top_slots = 0;
         }
         /*
             returns true IFF the map contains no elements.
@@ -408,7 +756,7 @@ namespace cop5536 {
             returns the number of slots in the backing array.
         */
         virtual size_t capacity() const {
-            return curr_capacity;
+            return arena.size() == 0 ? 0 : arena.size() - 1;
         }
         /*
             returns the number of items actually stored in the tree.
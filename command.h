@@ -0,0 +1,138 @@
+#ifndef _COMMAND_H_
+#define _COMMAND_H_
+
+#include <cstdlib>
+#include <cstdint>
+#include <string>
+
+namespace cop5536 {
+    /*
+        A decoded command: an opcode and its integer arguments, independent of whether it arrived as a text
+        line or in the binary format.
+    */
+    struct Command {
+        enum Opcode: uint8_t {
+            INVALID = 0,
+            INCREASE = 1,       //id m
+            REDUCE = 2,         //id m
+            COUNT = 3,          //id
+            NEXT = 4,           //id
+            PREVIOUS = 5,       //id
+            INRANGE = 6,        //id1 id2
+            INRANGE_LIMIT = 7,  //id1 id2 limit
+            TOPK = 8,           //id1 id2 k
+            INCREASE_AT = 9,    //id m t
+            TICK = 10,          //t
+            QUIT = 11,
+            NEXTN = 12,         //id n; numbered after quit so existing binary traces keep their opcodes
+            TOTAL = 13          //id1 id2
+        };
+        static const size_t max_args = 3;
+        Opcode op;
+        uint64_t args[max_args];
+        Command(): op(INVALID) {}
+
+        static size_t num_args(Opcode op) {
+            switch (op) {
+            case INCREASE: case REDUCE: case INRANGE: return 2;
+            case COUNT: case NEXT: case PREVIOUS: case TICK: return 1;
+            case NEXTN: case TOTAL: return 2;
+            case INRANGE_LIMIT: case TOPK: case INCREASE_AT: return 3;
+            default: return 0;
+            }
+        }
+
+        enum ParseResult {
+            PARSED,         //a well-formed command
+            NOT_A_COMMAND,  //blank, or an unknown name, or the wrong number of arguments; op is INVALID
+            BAD_ARGUMENT    //a known name with the right number of arguments, one of which is not a number that
+                            //fits in 64 bits; op is set, but the arguments are not
+        };
+
+        /*
+            Decode a text command line (e.g. "increase 350 100") without any intermediate strings. This is the one
+            table of command names and argument counts; callers decide what to do with lines that don't parse.
+            Names are case-insensitive, and quit ignores any arguments.
+        */
+        static ParseResult parse_text_line(std::string const& line, Command& cmd) {
+            cmd.op = INVALID;
+            const char* p = line.c_str();
+            while (is_space(*p))
+                ++p;
+            char name[9];
+            size_t name_len = 0;
+            for (; *p && ! is_space(*p); ++p) {
+                if (name_len == sizeof(name) - 1)
+                    return NOT_A_COMMAND;
+                char c = *p;
+                name[name_len++] = (c >= 'A' && c <= 'Z') ? c - ('Z' - 'z') : c;
+            }
+            name[name_len] = '\0';
+            size_t num_parsed = 0;
+            bool is_bad = false;
+            while (true) {
+                while (is_space(*p))
+                    ++p;
+                if ( ! *p)
+                    break;
+                uint64_t arg = 0;
+                bool is_number = true;
+                for (; *p && ! is_space(*p); ++p) {
+                    uint64_t digit = *p - '0';
+                    if (*p < '0' || *p > '9' || arg > (UINT64_MAX - digit) / 10)
+                        is_number = false; //not a digit, or out of range
+                    else
+                        arg = arg * 10 + digit;
+                }
+                if (num_parsed < max_args)
+                    cmd.args[num_parsed] = arg;
+                is_bad = is_bad || ! is_number;
+                ++num_parsed;
+            }
+            std::string n(name);
+            Opcode op = INVALID;
+            if (n == "increase")
+                op = num_parsed == 3 ? INCREASE_AT : INCREASE;
+            else if (n == "reduce")
+                op = REDUCE;
+            else if (n == "count")
+                op = COUNT;
+            else if (n == "next")
+                op = NEXT;
+            else if (n == "previous")
+                op = PREVIOUS;
+            else if (n == "nextn")
+                op = NEXTN;
+            else if (n == "inrange")
+                op = num_parsed == 3 ? INRANGE_LIMIT : INRANGE;
+            else if (n == "topk")
+                op = TOPK;
+            else if (n == "total")
+                op = TOTAL;
+            else if (n == "tick")
+                op = TICK;
+            else if (n == "quit")
+                op = QUIT;
+            if (op == INVALID || (op != QUIT && num_args(op) != num_parsed))
+                return NOT_A_COMMAND;
+            cmd.op = op;
+            return is_bad && op != QUIT ? BAD_ARGUMENT : PARSED;
+        }
+        /*
+            Decode a text command line, as parse_text_line does. Returns false if the line is not a well-formed
+            command, in which case cmd.op is INVALID.
+        */
+        static bool parse_text(std::string const& line, Command& cmd) {
+            if (parse_text_line(line, cmd) == PARSED)
+                return true;
+            cmd.op = INVALID;
+            return false;
+        }
+    private:
+        static bool is_space(char c) {
+            return c == ' ' || c == '\t' || c == '\r';
+        }
+    };
+}
+
+#endif
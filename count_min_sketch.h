@@ -0,0 +1,69 @@
+#ifndef _COUNT_MIN_SKETCH_H_
+#define _COUNT_MIN_SKETCH_H_
+
+#include <cstdlib>
+#include <cstdint>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+
+namespace cop5536 {
+    class CountMinSketch {
+    /*
+        A count-min sketch: depth rows of width counters, each row indexed by its own hash of the key. A key's
+        estimate is the smallest of its counters, which never undercounts and, with probability at least
+        1 - e^-depth, overcounts by no more than e / width times the total count added. The memory used is
+        fixed up front, no matter how many distinct keys are added.
+    */
+    public:
+        typedef uint64_t key_type;
+        typedef uint64_t value_type;
+    private:
+        static const size_t depth = 4;
+        std::vector<value_type> counters; //depth rows of width counters, one row after the other
+        size_t width_bits;
+        size_t index(size_t row, key_type key) const {
+            //multiply-add-shift hashing, with a fixed odd multiplier per row so results are reproducible
+            static const uint64_t multipliers[depth] = {
+                0x9e3779b97f4a7c15ULL, 0xc2b2ae3d27d4eb4fULL, 0x165667b19e3779f9ULL, 0xd6e8feb86659fd93ULL
+            };
+            static const uint64_t increments[depth] = {
+                0x632be59bd9b4e019ULL, 0x85ebca77c2b2ae63ULL, 0x27d4eb2f165667c5ULL, 0xff51afd7ed558ccdULL
+            };
+            uint64_t h = key * multipliers[row] + increments[row];
+            return (row << width_bits) + (width_bits == 0 ? 0 : h >> (64 - width_bits));
+        }
+    public:
+        /*
+            An empty sketch, which holds no counters and is not enabled.
+        */
+        CountMinSketch(): width_bits(0) {}
+        /*
+            A sketch using at most budget_bytes of counters. Rows are a power of two wide, so the width is the
+            largest power of two that fits the budget.
+        */
+        CountMinSketch(size_t budget_bytes): width_bits(0) {
+            size_t max_width = budget_bytes / (depth * sizeof(value_type));
+            if (max_width == 0)
+                throw std::domain_error("Sketch memory budget is too small to hold a single column");
+            while ((size_t(2) << width_bits) <= max_width && width_bits < 63)
+                ++width_bits;
+            counters.assign(depth << width_bits, 0);
+        }
+        bool is_enabled() const {
+            return ! counters.empty();
+        }
+        void add(key_type key, value_type m) {
+            for (size_t row = 0; row != depth; ++row)
+                counters[index(row, key)] += m;
+        }
+        value_type estimate(key_type key) const {
+            value_type est = counters[index(0, key)];
+            for (size_t row = 1; row != depth; ++row)
+                est = std::min(est, counters[index(row, key)]);
+            return est;
+        }
+    };
+}
+
+#endif
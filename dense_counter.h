@@ -0,0 +1,398 @@
+#ifndef _DENSE_COUNTER_H_
+#define _DENSE_COUNTER_H_
+
+#include <cstdlib>
+#include <cstdint>
+#include <vector>
+#include <queue>
+#include <algorithm>
+
+namespace cop5536 {
+    class DenseCounter {
+    /*
+        An event counter for IDs that fill most of [0, N): counts live in a flat array indexed by ID, rather than in
+        tree nodes. Which IDs are present is kept in a bitmap, with a summary bitmap holding one bit per nonempty
+        bitmap word, so next/previous find the nearest present ID with a couple of word-level bit scans (count
+        trailing/leading zeros) instead of visiting IDs one at a time. A Fenwick tree over the counts gives the total
+        of any ID range in O(log N), and a max tree over 64-ID blocks lets top-k skip blocks holding only small
+        counts, like the tree engine's subtree maxima. All told that is about 16 bytes per ID in [0, N), against a
+        tree node of 80 bytes per present ID, so it only pays off while IDs are dense; see is_dense.
+    */
+    public:
+        typedef uint64_t key_type;
+        typedef uint64_t value_type;
+        typedef std::pair<key_type, value_type> kv_pair;
+        typedef std::vector<kv_pair> kv_list;
+        static const size_t max_span_per_id = 2; //IDs are dense enough as long as at least half of [0, N) is present
+    private:
+        static const size_t bits_per_word = 64;
+        static const size_t min_capacity = bits_per_word * bits_per_word;
+        std::vector<value_type> counts; //count of every ID below capacity, 0 for absent IDs
+        std::vector<uint64_t> present; //bit per ID, set IFF the ID is in the counter (possibly with a count of 0)
+        std::vector<uint64_t> nonempty_words; //bit per word of present, set IFF that word has any bit set
+        std::vector<value_type> prefix_sums; //Fenwick tree over counts, 1-based
+        std::vector<value_type> block_max; //max tree over the largest count of each word's IDs, 1-based heap layout, leaves at num_words()
+        size_t num_present;
+
+        size_t num_words() const {
+            return present.size();
+        }
+        void add_to_sums(key_type id, value_type delta) {
+            //unsigned arithmetic, so a decrease is passed as its two's complement and wraps back around
+            for (size_t i = id + 1; i < prefix_sums.size(); i += i & (0 - i))
+                prefix_sums[i] += delta;
+        }
+        value_type sum_below(size_t end) const {
+            //total count of the IDs in [0, end)
+            value_type sum = 0;
+            for (size_t i = std::min(end, capacity()); i != 0; i -= i & (0 - i))
+                sum += prefix_sums[i];
+            return sum;
+        }
+        void update_block_max(size_t word) {
+            //recompute the largest count in the word, then fix the maxima on the way up to the root
+            value_type word_max = 0;
+            for (uint64_t bits = present[word]; bits != 0; bits &= bits - 1)
+                word_max = std::max(word_max, counts[word * bits_per_word + __builtin_ctzll(bits)]);
+            size_t i = num_words() + word;
+            block_max[i] = word_max;
+            for (i /= 2; i != 0; i /= 2)
+                block_max[i] = std::max(block_max[2 * i], block_max[2 * i + 1]);
+        }
+        void raise_block_max(key_type id) {
+            //a count went up, so the maxima above it can only go up
+            for (size_t i = num_words() + id / bits_per_word; i != 0 && block_max[i] < counts[id]; i /= 2)
+                block_max[i] = counts[id];
+        }
+        void set_present(key_type id, bool is_present) {
+            size_t word = id / bits_per_word;
+            uint64_t bit = uint64_t(1) << (id % bits_per_word);
+            if (is_present)
+                present[word] |= bit;
+            else
+                present[word] &= ~bit;
+            uint64_t summary_bit = uint64_t(1) << (word % bits_per_word);
+            if (present[word] != 0)
+                nonempty_words[word / bits_per_word] |= summary_bit;
+            else
+                nonempty_words[word / bits_per_word] &= ~summary_bit;
+        }
+        bool is_present(key_type id) const {
+            return id < capacity() && (present[id / bits_per_word] >> (id % bits_per_word) & 1) != 0;
+        }
+        void resize(size_t new_capacity) {
+            //capacity is a power of two, at least min_capacity, so every level of the bitmap is made of whole words
+            counts.resize(new_capacity, 0);
+            present.resize(new_capacity / bits_per_word, 0);
+            nonempty_words.resize(new_capacity / bits_per_word / bits_per_word, 0);
+            //the sums and maxima depend on the capacity, so they are rebuilt from the counts, in O(capacity)
+            prefix_sums.assign(new_capacity + 1, 0);
+            for (size_t i = 1; i <= new_capacity; ++i) {
+                prefix_sums[i] += counts[i - 1];
+                size_t parent = i + (i & (0 - i));
+                if (parent <= new_capacity)
+                    prefix_sums[parent] += prefix_sums[i];
+            }
+            block_max.assign(2 * num_words(), 0);
+            for (size_t word = 0; word != num_words(); ++word)
+                for (uint64_t bits = present[word]; bits != 0; bits &= bits - 1)
+                    block_max[num_words() + word] = std::max(block_max[num_words() + word], counts[word * bits_per_word + __builtin_ctzll(bits)]);
+            for (size_t i = num_words() - 1; i != 0; --i)
+                block_max[i] = std::max(block_max[2 * i], block_max[2 * i + 1]);
+        }
+        static size_t capacity_for(key_type id) {
+            size_t new_capacity = min_capacity;
+            while (new_capacity <= id)
+                new_capacity *= 2;
+            return new_capacity;
+        }
+        bool find_at_least(key_type id, key_type& found) const {
+            //find the lowest present ID which is greater than or equal to id
+            if (id >= capacity())
+                return false;
+            size_t word = id / bits_per_word;
+            uint64_t bits = present[word] & (~uint64_t(0) << (id % bits_per_word));
+            if (bits == 0) {
+                //nothing more in this word, so find the next nonempty word from the summary
+                size_t next_word = word + 1;
+                size_t summary = next_word / bits_per_word;
+                if (next_word == num_words())
+                    return false;
+                uint64_t summary_bits = nonempty_words[summary] & (~uint64_t(0) << (next_word % bits_per_word));
+                while (summary_bits == 0) {
+                    if (++summary == nonempty_words.size())
+                        return false;
+                    summary_bits = nonempty_words[summary];
+                }
+                word = summary * bits_per_word + __builtin_ctzll(summary_bits);
+                bits = present[word];
+            }
+            found = word * bits_per_word + __builtin_ctzll(bits);
+            return true;
+        }
+        bool find_at_most(key_type id, key_type& found) const {
+            //find the greatest present ID which is less than or equal to id
+            if (id >= capacity())
+                id = capacity() - 1;
+            size_t word = id / bits_per_word;
+            uint64_t bits = present[word] & (~uint64_t(0) >> (bits_per_word - 1 - id % bits_per_word));
+            if (bits == 0) {
+                if (word == 0)
+                    return false;
+                size_t prev_word = word - 1;
+                size_t summary = prev_word / bits_per_word;
+                uint64_t summary_bits = nonempty_words[summary] & (~uint64_t(0) >> (bits_per_word - 1 - prev_word % bits_per_word));
+                while (summary_bits == 0) {
+                    if (summary-- == 0)
+                        return false;
+                    summary_bits = nonempty_words[summary];
+                }
+                word = summary * bits_per_word + (bits_per_word - 1 - __builtin_clzll(summary_bits));
+                bits = present[word];
+            }
+            found = word * bits_per_word + (bits_per_word - 1 - __builtin_clzll(bits));
+            return true;
+        }
+        struct TopKCandidate {
+            //either a single ID, or a node of the max tree, whose IDs' counts are bounded by the node's max
+            value_type bound;
+            key_type min_key; //no ID this candidate can yield is smaller than this, used to break ties by lowest ID
+            size_t index; //the ID, or the max tree node
+            bool is_block;
+            TopKCandidate(value_type bound, key_type min_key, size_t index, bool is_block):
+                bound(bound), min_key(min_key), index(index), is_block(is_block) {}
+            bool operator<(TopKCandidate const& other) const {
+                //std::priority_queue pops the greatest element, so "less than" means "yielded later"
+                if (bound != other.bound)
+                    return bound < other.bound;
+                if (min_key != other.min_key)
+                    return min_key > other.min_key;
+                return is_block && ! other.is_block;
+            }
+        };
+    public:
+        /*
+            Walks the (id, count) pairs of an ID range in ascending ID order, one bit scan per step. The cursor is
+            invalidated by any operation that modifies the counter.
+        */
+        class RangeCursor {
+        private:
+            friend class DenseCounter;
+            DenseCounter const* dc;
+            key_type k_r;
+            key_type at;
+            bool is_valid;
+            RangeCursor(DenseCounter const* dc, key_type k_l, key_type k_r): dc(dc), k_r(k_r), at(0) {
+                is_valid = dc->find_at_least(k_l, at) && at <= k_r;
+            }
+        public:
+            bool valid() const {
+                return is_valid;
+            }
+            key_type key() const {
+                return at;
+            }
+            value_type value() const {
+                return dc->counts[at];
+            }
+            void advance() {
+                is_valid = at < k_r && dc->find_at_least(at + 1, at) && at <= k_r;
+            }
+        };
+
+        DenseCounter(): num_present(0) {
+            resize(min_capacity);
+        }
+        /*
+            Initialize from a list of key-values, in O(N) time where N is the largest key. Keys need not be sorted.
+        */
+        DenseCounter(kv_list const& init_kvs): num_present(0) {
+            key_type max_key = 0;
+            for (kv_pair const& kv: init_kvs)
+                max_key = std::max(max_key, kv.first);
+            counts.assign(capacity_for(max_key), 0);
+            present.assign(counts.size() / bits_per_word, 0);
+            nonempty_words.assign(present.size() / bits_per_word, 0);
+            for (kv_pair const& kv: init_kvs) {
+                if ( ! is_present(kv.first))
+                    ++num_present;
+                counts[kv.first] = kv.second;
+                set_present(kv.first, true);
+            }
+            resize(counts.size());
+        }
+        /*
+            Initialize from a cursor over key-values in ascending key order (such as another counter's
+            RangeCursor), the largest key being max_key, in O(N) time where N is the largest key.
+        */
+        template <typename Cursor>
+        DenseCounter(Cursor cursor, key_type max_key): num_present(0) {
+            counts.assign(capacity_for(max_key), 0);
+            present.assign(counts.size() / bits_per_word, 0);
+            nonempty_words.assign(present.size() / bits_per_word, 0);
+            for (; cursor.valid(); cursor.advance()) {
+                ++num_present;
+                counts[cursor.key()] = cursor.value();
+                set_present(cursor.key(), true);
+            }
+            resize(counts.size());
+        }
+
+        /*
+            Return true IFF num_ids IDs, the largest of which is max_id, are dense enough for this engine.
+        */
+        static bool is_dense(key_type max_id, size_t num_ids) {
+            return num_ids != 0 && max_id / max_span_per_id < num_ids;
+        }
+        /*
+            Return true IFF id can be added while keeping the IDs dense. Every ID below the capacity can.
+        */
+        bool fits(key_type id) const {
+            return id < capacity() || is_dense(id, num_present + 1);
+        }
+        size_t capacity() const {
+            return counts.size();
+        }
+        size_t size() const {
+            return num_present;
+        }
+
+        /*
+        Increase the count of the event ID by m. If ID is not present, insert it, making room for it if need be.
+        Return the count of ID after the addition.
+        */
+        uint64_t increase(key_type id, uint64_t m) {
+            if (id >= capacity())
+                resize(capacity_for(id));
+            if ( ! is_present(id)) {
+                set_present(id, true);
+                ++num_present;
+            }
+            counts[id] += m;
+            add_to_sums(id, m);
+            raise_block_max(id);
+            return counts[id];
+        }
+
+        /*
+        Decrease the count of ID by m. If ID’s count becomes less than or equal to 0,
+        remove ID from the counter.
+        Return the count of ID after the deletion, or 0 if ID is removed or not present.
+        */
+        uint64_t reduce(key_type id, uint64_t m) {
+            if ( ! is_present(id))
+                return 0;
+            value_type curr_v = counts[id];
+            if (m >= curr_v) {
+                m = curr_v;
+                set_present(id, false);
+                --num_present;
+            }
+            counts[id] -= m;
+            add_to_sums(id, 0 - m);
+            update_block_max(id / bits_per_word);
+            return counts[id];
+        }
+
+        /*
+        Return the count of ID. If not present return 0.
+        */
+        uint64_t count(key_type id) const {
+            return id < capacity() ? counts[id] : 0;
+        }
+
+        /*
+        Store the count of each of n IDs in counts, 0 for IDs not present.
+        */
+        void count_batch(key_type const* ids, size_t n, value_type* found_counts) const {
+            for (size_t i = 0; i != n; ++i)
+                found_counts[i] = count(ids[i]);
+        }
+
+        /*
+        Return ID and count of the event with lowest ID that is greater than ID. Return “0 0” if there is no next ID.
+        */
+        kv_pair next(key_type id) const {
+            key_type found;
+            if (id == UINT64_MAX || ! find_at_least(id + 1, found))
+                return kv_pair(0, 0);
+            return kv_pair(found, counts[found]);
+        }
+
+        /*
+        Return ID and count of the event with greatest ID that is less than ID. Return “0 0” if there is no previous ID.
+        */
+        kv_pair previous(key_type id) const {
+            key_type found;
+            if (id == 0 || ! find_at_most(id - 1, found))
+                return kv_pair(0, 0);
+            return kv_pair(found, counts[found]);
+        }
+
+        /*
+        Return the sum of the counts of IDs between ID1 and ID2 inclusively, in O(log N) time. Note ID1 ≤ ID2 .
+        */
+        value_type total(key_type id1, key_type id2) const {
+            if (id1 > id2 || id1 >= capacity())
+                return 0;
+            return sum_below(id2 >= capacity() ? capacity() : id2 + 1) - sum_below(id1);
+        }
+
+        /*
+        Return up to k (ID, count) pairs with the largest counts among IDs between ID1 and ID2 inclusively,
+        largest count first and lowest ID first among equal counts. Note ID1 ≤ ID2 .
+        This is a best-first search over the block maxima, like the tree engine's search over subtree maxima.
+        */
+        void top_k(key_type id1, key_type id2, size_t k, kv_list& top) const {
+            std::priority_queue<TopKCandidate> candidates;
+            if (id1 < capacity())
+                candidates.push(TopKCandidate(block_max[1], id1, 1, true));
+            while ( ! candidates.empty() && top.size() < k) {
+                TopKCandidate best = candidates.top();
+                candidates.pop();
+                if ( ! best.is_block) {
+                    //nothing left in the queue can beat this ID
+                    top.push_back(kv_pair(best.index, counts[best.index]));
+                    continue;
+                }
+                if (best.index >= num_words()) {
+                    //a single word: split it into its present IDs within the range
+                    size_t word = best.index - num_words();
+                    for (uint64_t bits = present[word]; bits != 0; bits &= bits - 1) {
+                        key_type id = word * bits_per_word + __builtin_ctzll(bits);
+                        if (id >= id1 && id <= id2)
+                            candidates.push(TopKCandidate(counts[id], id, id, false));
+                    }
+                    continue;
+                }
+                //split the node into its children, skipping children that lie entirely outside the range; nodes
+                //at depth d of the max tree each cover capacity / 2^d IDs
+                size_t child_depth = bits_per_word - __builtin_clzll(best.index);
+                size_t span = capacity() >> child_depth;
+                for (size_t child = 2 * best.index; child != 2 * best.index + 2; ++child) {
+                    key_type first_id = (child - (size_t(1) << child_depth)) * span;
+                    if (first_id <= id2 && first_id + span - 1 >= id1)
+                        candidates.push(TopKCandidate(block_max[child], std::max(id1, first_id), child, true));
+                }
+            }
+        }
+
+        /*
+        Return a cursor positioned at the first ID between ID1 and ID2 inclusively. Note ID1 ≤ ID2 .
+        */
+        RangeCursor range(key_type id1, key_type id2) const {
+            return RangeCursor(this, id1, id2);
+        }
+
+        /*
+        Return a cursor positioned at the lowest ID that is greater than ID, running to the end of the counter.
+        */
+        RangeCursor after(key_type id) const {
+            if (id == UINT64_MAX)
+                return RangeCursor(this, capacity(), 0);
+            return RangeCursor(this, id + 1, UINT64_MAX);
+        }
+    };
+}
+
+#endif
@@ -2,6 +2,12 @@
 #define _DRIVER_H_
 
 #include "event_counter.h"
+#include "dense_counter.h"
+#include "timing_wheel.h"
+#include "count_min_sketch.h"
+#include "command.h"
+#include "result.h"
+#include "input_file.h"
 
 #include <iostream>
 #include <ctime>
@@ -10,80 +16,135 @@
 #include <cstdlib>
 #include <sstream>
 #include <vector>
+#include <unordered_set>
 #include <stdexcept>
 #include <cmath>
 #include <algorithm>
 #include <string.h>
+#include <cstdint>
 
 namespace cop5536 {
-    class Driver {
+    template <typename Counter>
+    class BasicDriver {
+    /*
+        Runs text commands against an event counter built on the given tree engine (see BasicEventCounter),
+        with the dense engine, windowed expiry and the approximate front-end layered on top as configured.
+    */
     private:
-        EventCounter ec;
-        typedef std::vector<std::string> str_list;
-        void split(const std::string& str, const std::string& delim, std::vector<std::string>& parts) {
-            //get an input string and split it by a given token, pushing the components into a specified output list
-            char *str_cpy = (char*)malloc(str.size() + 1),
-                *part;
-            strcpy(str_cpy, str.c_str());
-            part = strtok(str_cpy, delim.c_str());
-            while (part != nullptr) {
-                std::string str_part(part);
-                parts.push_back(str_part);
-                part = strtok(nullptr, delim.c_str());
-            }
-            free(str_cpy);
+        Counter ec;
+        DenseCounter dense; //holds the counts instead of ec while is_dense is set
+        bool is_dense;
+        uint64_t window; //number of ticks a timestamped increase stays counted for, or 0 if counts never expire
+        TimingWheel expiries;
+        CountMinSketch sketch; //front-end for IDs not yet promoted into ec, when approximate mode is on
+        uint64_t promote_threshold; //estimated count at which an ID moves from the sketch into ec
+        std::unordered_set<uint64_t> zeroed_ids; //IDs out of the sketch whose exact count has been reduced to 0
+        std::string arena_file; //file to keep ec's nodes in, or empty to keep them in memory
+
+        void leave_dense() {
+            //an ID far beyond the dense range turned up, so move every count over to the tree, streaming them
+            //into its node array in ID order
+            ec.start_sorted_build(dense.size());
+            for (DenseCounter::RangeCursor cursor = dense.range(0, UINT64_MAX); cursor.valid(); cursor.advance())
+                ec.add_sorted(cursor.key(), cursor.value());
+            ec.finish_sorted_build();
+            dense = DenseCounter();
+            is_dense = false;
         }
 
-        std::string str_to_lcase(std::string str) {
-            //make a copy of an input string, with all letters converted to lowercase
-            std::transform(str.begin(), str.end(), str.begin(), [](char c) {
-                if (c >= 'A' && c <= 'Z')
-                    return (char)(c - ('Z' - 'z'));
-                return (char)c;
-            });
-            return str;
-        }
-
-        void read_kvs(std::ifstream& if_handle, EventCounter::kv_list& kvs_out) {
-            //given an input file handle, read all valid key-value pairs
-            std::string line;
-            str_list parts;
-            while (std::getline (if_handle, line))
-            {
-                parts.clear();
-                split(line, " ", parts);
-                if (parts.size() == 2) {
-                    uint64_t k(std::stoull(parts[0]));
-                    uint64_t v(std::stoull(parts[1]));
-                    EventCounter::kv_pair kv(k, v);
-                    kvs_out.push_back(kv);
-                }
-            }
+        uint64_t exact_count(uint64_t id) const {
+            return is_dense ? dense.count(id) : ec.count(id);
         }
 
-        bool read_inp_f(std::string const& if_name, EventCounter::kv_list& kvs) {
-            //given an input file name, read all valid key-value pairs
-            std::ifstream if_handle(if_name);
-            if ( ! if_handle.is_open()) {
-                std::cout << "Could not open input file " << if_name << std::endl;
-                return false;
+        uint64_t exact_increase(uint64_t id, uint64_t m) {
+            if (is_dense && ! dense.fits(id))
+                leave_dense();
+            return is_dense ? dense.increase(id, m) : ec.increase(id, m);
+        }
+
+        bool in_sketch(uint64_t id) const {
+            //whether the ID is counted by the sketch: approximate mode is on, and the ID has never been promoted
+            return sketch.is_enabled() && exact_count(id) == 0 && zeroed_ids.count(id) == 0;
+        }
+
+        uint64_t do_increase(uint64_t id, uint64_t m) {
+            //in approximate mode, an ID is only counted exactly once its estimated count reaches the threshold
+            if (in_sketch(id)) {
+                sketch.add(id, m);
+                uint64_t estimate = sketch.estimate(id);
+                if (estimate < promote_threshold)
+                    return estimate;
+                //the sketch only ever grows, as its counters are shared with other IDs: taking the ID's count back
+                //out would take some of theirs with it, and they could then undercount
+                return exact_increase(id, estimate);
             }
-            read_kvs(if_handle, kvs);
-            if_handle.close();
-            return true;
+            if ( ! zeroed_ids.empty())
+                zeroed_ids.erase(id);
+            return exact_increase(id, m);
         }
 
+        uint64_t do_reduce(uint64_t id, uint64_t m) {
+            //reduces of IDs still in the sketch are dropped, for the same reason, so their estimate stands
+            if (in_sketch(id))
+                return sketch.estimate(id);
+            uint64_t count = is_dense ? dense.reduce(id, m) : ec.reduce(id, m);
+            //a promoted ID reduced to 0 leaves the tree, but must not fall back to its stale sketch estimate
+            if (count == 0 && sketch.is_enabled())
+                zeroed_ids.insert(id);
+            return count;
+        }
+
+        uint64_t do_count(uint64_t id) const {
+            return in_sketch(id) ? sketch.estimate(id) : exact_count(id);
+        }
+
+        size_t expire_until(uint64_t tick) {
+            //drop every windowed increase whose window has closed by the given tick
+            return expiries.advance(tick, [this](typename Counter::key_type id, typename Counter::value_type m) {
+                do_reduce(id, m);
+            });
+        }
+
+        static const size_t values_per_result = 256; //long responses are split into results of at most this many values
+
         /*
         Increase the count of the event ID by m. If ID is not present, insert it.
         Print the count of ID after the addition.
         */
-        bool increase(str_list const& parts) {
-            if (parts.size() != 3)
-                return false;
-            uint64_t id = std::stoull(parts[1]);
-            uint64_t m = std::stoull(parts[2]);
-            std::cout << ec.increase(id, m) << std::endl;
-            return true;
+        template <typename Sink>
+        void increase(uint64_t id, uint64_t m, Sink& sink) {
+            sink.begin(Result::VALUE).first = do_increase(id, m);
+            sink.commit();
+        }
+
+        /*
+        In windowed mode, increase the count of the event ID by m at timestamp bucket T; the current time moves
+        up to T and the m events are taken back out of the count once the window has passed T.
+        Print the count of ID after the addition.
+        */
+        template <typename Sink>
+        void increase_at(uint64_t id, uint64_t m, uint64_t t, Sink& sink) {
+            expire_until(t);
+            uint64_t expiry = t > UINT64_MAX - window ? UINT64_MAX : t + window;
+            Result& r = sink.begin(Result::VALUE);
+            if (expiry <= expiries.current_tick()) {
+                //the events are older than the window, so they no longer count
+                r.first = do_count(id);
+            } else {
+                expiries.schedule(expiry, id, m);
+                r.first = do_increase(id, m);
+            }
+            sink.commit();
+        }
+
+        /*
+        Move the current time up to T, expiring windowed increases whose window has passed.
+        Print the number of increases expired.
+        */
+        template <typename Sink>
+        void tick(uint64_t t, Sink& sink) {
+            sink.begin(Result::VALUE).first = expire_until(t);
+            sink.commit();
         }
 
         /*
@@ -91,109 +152,292 @@ namespace cop5536 {
         remove ID from the counter.
         Print the count of ID after the deletion, or 0 if ID is removed or not present.
         */
-        bool reduce(str_list const& parts) {
-            if (parts.size() != 3)
-                return false;
-            uint64_t id = std::stoull(parts[1]);
-            uint64_t m = std::stoull(parts[2]);
-            std::cout << ec.reduce(id, m) << std::endl;
-            return true;
+        template <typename Sink>
+        void reduce(uint64_t id, uint64_t m, Sink& sink) {
+            sink.begin(Result::VALUE).first = do_reduce(id, m);
+            sink.commit();
         }
 
         /*
         Print the total count for IDs between ID1 and ID2 inclusively. Note ID1 ≤ ID2 .
+        With an optional LIMIT, print at most LIMIT counts; if the range holds more, the line
+        ends with "next=ID", where ID is the ID1 to resume from with the next request.
         */
-        bool inrange(str_list const& parts) {
-            if (parts.size() != 3)
-                return false;
-            uint64_t id1 = std::stoull(parts[1]);
-            uint64_t id2 = std::stoull(parts[2]);
-            EventCounter::value_list values;
-            ec.in_range(id1, id2, values);
-            bool prepend_space = false;
-            for (EventCounter::value_type const& val: values) {
-                if (prepend_space)
-                    std::cout << ' ';
-                else
-                    prepend_space = true;
-                std::cout << val;
+        template <typename Sink>
+        void inrange(uint64_t id1, uint64_t id2, uint64_t limit, Sink& sink) const {
+            if (is_dense)
+                list_counts(dense.range(id1, id2), limit, sink);
+            else
+                list_counts(ec.range(id1, id2), limit, sink);
+        }
+        template <typename Cursor, typename Sink>
+        void list_counts(Cursor cursor, uint64_t limit, Sink& sink) const {
+            //hand the counts over a bounded number at a time rather than collecting them all first
+            bool continuation = false;
+            while (true) {
+                Result& r = sink.begin(Result::VALUES);
+                r.continuation = continuation;
+                for (; cursor.valid() && limit != 0 && r.values.size() != values_per_result; cursor.advance(), --limit)
+                    r.values.push_back(cursor.value());
+                if (cursor.valid() && limit != 0) {
+                    r.continues = continuation = true;
+                    sink.commit();
+                    continue;
+                }
+                if (cursor.valid()) {
+                    r.has_resume = true;
+                    r.resume_id = cursor.key();
+                }
+                sink.commit();
+                return;
             }
-            std::cout << std::endl;
-            return true;
         }
 
         /*
         Print ID and count of the event with lowest ID that is greater than ID. Print “0 0” if there is no next ID.
         */
-        bool next(str_list const& parts) {
-            if (parts.size() != 2)
-                return false;
-            uint64_t id = std::stoull(parts[1]);
-            EventCounter::kv_pair match = ec.next(id);
-            std::cout << match.first << ' ' << match.second << std::endl;
-            return true;
+        template <typename Sink>
+        void next(uint64_t id, Sink& sink) const {
+            typename Counter::kv_pair match = is_dense ? dense.next(id) : ec.next(id);
+            Result& r = sink.begin(Result::PAIR);
+            r.first = match.first;
+            r.second = match.second;
+            sink.commit();
+        }
+
+        /*
+        Print the ID and count of each of the N events with the lowest IDs greater than ID, in ID order.
+        Fewer are printed if the counter runs out of IDs first.
+        */
+        template <typename Sink>
+        void nextn(uint64_t id, uint64_t n, Sink& sink) const {
+            if (is_dense)
+                list_pairs(dense.after(id), n, sink);
+            else
+                list_pairs(ec.after(id), n, sink);
+        }
+        template <typename Cursor, typename Sink>
+        void list_pairs(Cursor cursor, uint64_t n, Sink& sink) const {
+            //hand the pairs over a bounded number at a time, as list_counts does
+            bool continuation = false;
+            while (true) {
+                Result& r = sink.begin(Result::PAIRS);
+                r.continuation = continuation;
+                for (; cursor.valid() && n != 0 && r.values.size() != values_per_result; cursor.advance(), --n) {
+                    r.values.push_back(cursor.key());
+                    r.values.push_back(cursor.value());
+                }
+                r.continues = continuation = cursor.valid() && n != 0;
+                sink.commit();
+                if ( ! continuation)
+                    return;
+            }
         }
 
         /*
         Print ID and count of the event with greatest ID that is less than ID. Print “0 0” if there is no previous ID.
         */
-        bool previous(str_list const& parts) {
-            if (parts.size() != 2)
-                return false;
-            uint64_t id = std::stoull(parts[1]);
-            EventCounter::kv_pair match = ec.previous(id);
-            std::cout << match.first << ' ' << match.second << std::endl;
-            return true;
+        template <typename Sink>
+        void previous(uint64_t id, Sink& sink) const {
+            typename Counter::kv_pair match = is_dense ? dense.previous(id) : ec.previous(id);
+            Result& r = sink.begin(Result::PAIR);
+            r.first = match.first;
+            r.second = match.second;
+            sink.commit();
+        }
+
+        /*
+        Print the ID and count of the K events with the largest counts between ID1 and ID2 inclusively,
+        largest count first. Note ID1 ≤ ID2 .
+        */
+        template <typename Sink>
+        void topk(uint64_t id1, uint64_t id2, uint64_t k, Sink& sink) const {
+            typename Counter::kv_list top;
+            if (is_dense)
+                dense.top_k(id1, id2, k, top);
+            else
+                ec.top_k(id1, id2, k, top);
+            Result& r = sink.begin(Result::PAIRS);
+            for (typename Counter::kv_pair const& kv: top) {
+                r.values.push_back(kv.first);
+                r.values.push_back(kv.second);
+            }
+            sink.commit();
+        }
+
+        /*
+        Print the sum of the counts of IDs between ID1 and ID2 inclusively. Note ID1 ≤ ID2 .
+        */
+        template <typename Sink>
+        void total(uint64_t id1, uint64_t id2, Sink& sink) const {
+            sink.begin(Result::VALUE).first = is_dense ? dense.total(id1, id2) : ec.total(id1, id2);
+            sink.commit();
         }
 
         /*
         Print the count of ID. If not present print 0.
         */
-        bool count(str_list const& parts) {
-            if (parts.size() != 2)
-                return false;
-            uint64_t id = std::stoull(parts[1]);
-            std::cout << ec.count(id) << std::endl;
-            return true;
+        template <typename Sink>
+        void count(uint64_t id, Sink& sink) const {
+            sink.begin(Result::VALUE).first = do_count(id);
+            sink.commit();
         }
     public:
-        Driver(): ec(1) { }
+        BasicDriver(): ec(1), is_dense(false), window(0), promote_threshold(0) { }
+        void set_window(uint64_t ticks) {
+            //turn on windowed mode, where timestamped increases expire the given number of ticks after their timestamp
+            window = ticks;
+        }
+        void set_arena_file(std::string const& path) {
+            //keep the tree's nodes in a new file at the given path, or in the given directory, instead of memory,
+            //for counters larger than memory; an existing file is refused rather than overwritten. Such a counter
+            //always uses the tree engine, as the dense engine's arrays can only live in memory
+            arena_file = path;
+        }
+        void set_approximate(size_t budget_bytes, uint64_t threshold) {
+            //turn on approximate mode, where IDs are counted in a fixed-size sketch until their estimated count
+            //reaches the threshold. count reports sketch estimates for IDs still in the sketch, which overcount by
+            //at most e / width of the total counted (with probability 1 - e^-4); the other commands only see
+            //promoted IDs, each of which was left out with a true count below the threshold. The sketch never
+            //undercounts, as nothing is ever taken out of it: reduce of an ID still in the sketch does nothing and
+            //returns its estimate, as count would. Once promoted, an ID is counted exactly for good, even after
+            //being reduced to 0
+            sketch = CountMinSketch(budget_bytes);
+            promote_threshold = threshold;
+        }
         bool load_file(std::string inp_f) {
             //set the current copy of the event counter to one instantiated with the given input file name
-            EventCounter::kv_list kvs;
-            if ( ! read_inp_f(inp_f, kvs))
+            //IDs that fill most of [0, max ID] are kept in the dense engine, which needs far less memory per ID
+            //the pairs go straight into a tree, and are only copied out of it if they turn out to be dense
+            Counter new_ec(1);
+            if ( ! arena_file.empty()) {
+                try {
+                    new_ec.back_with_file(arena_file);
+                } catch (std::exception& e) {
+                    std::cout << "Could not use arena file: " << e.what() << std::endl;
+                    return false;
+                }
+            }
+            uint64_t max_id = 0;
+            if ( ! input_file::load(inp_f, new_ec, max_id))
+                return false;
+            zeroed_ids.clear();
+            is_dense = arena_file.empty() && DenseCounter::is_dense(max_id, new_ec.size());
+            if (is_dense) {
+                dense = DenseCounter(new_ec.range(0, UINT64_MAX), max_id);
+                ec = Counter(1);
+            } else {
+                dense = DenseCounter();
+                ec = std::move(new_ec);
+            }
+            return true;
+        }
+        /*
+            Run n count commands for the given IDs, like execute_read_only would one by one, but with the tree
+            lookups interleaved (see EventCounter::count_batch). At most max_count_batch IDs at a time.
+        */
+        static const size_t max_count_batch = 64;
+        template <typename Sink>
+        void count_batch(uint64_t const* ids, size_t n, Sink& sink) const {
+            uint64_t counts[max_count_batch];
+            if (is_dense)
+                dense.count_batch(ids, n, counts);
+            else
+                ec.count_batch(ids, n, counts);
+            for (size_t i = 0; i != n; ++i) {
+                Result& r = sink.begin(Result::VALUE);
+                r.first = counts[i] == 0 && sketch.is_enabled() && zeroed_ids.count(ids[i]) == 0 ? sketch.estimate(ids[i]) : counts[i];
+                sink.commit();
+            }
+        }
+        /*
+            Decode a text command line with Command::parse_text_line. Returns false, leaving cmd unchanged, for
+            blank lines and for unknown or malformed commands, which are ignored, as are the timestamped increase
+            and tick outside windowed mode; throws if an argument is not a number.
+        */
+        bool parse(std::string const& line, Command& cmd) const {
+            Command parsed;
+            Command::ParseResult result = Command::parse_text_line(line, parsed);
+            if (result == Command::NOT_A_COMMAND)
                 return false;
-            EventCounter new_ec(kvs);
-            ec = new_ec;
+            if (window == 0 && (parsed.op == Command::INCREASE_AT || parsed.op == Command::TICK))
+                return false;
+            if (result == Command::BAD_ARGUMENT)
+                throw std::invalid_argument("Command arguments must be whole numbers below 2^64");
+            cmd = parsed;
             return true;
         }
-        void run_cmd(std::string const& line) {
+        /*
+            Run a decoded command, handing its result(s) to sink: a Result& sink.begin(Result::Kind) to fill in,
+            then sink.commit() once it is complete. Quit and invalid commands produce nothing.
+        */
+        template <typename Sink>
+        void execute(Command const& cmd, Sink& sink) {
+            uint64_t const* a = cmd.args;
+            switch (cmd.op) {
+            case Command::INCREASE: increase(a[0], a[1], sink); break;
+            case Command::INCREASE_AT: increase_at(a[0], a[1], a[2], sink); break;
+            case Command::TICK: tick(a[0], sink); break;
+            case Command::REDUCE: reduce(a[0], a[1], sink); break;
+            default: execute_read_only(cmd, sink); break;
+            }
+        }
+        /*
+            Return true IFF the command only reads the counter, so any number of them may run at once as long
+            as nothing modifies the counter in the meantime.
+        */
+        static bool is_read_only(Command const& cmd) {
+            switch (cmd.op) {
+            case Command::INRANGE: case Command::INRANGE_LIMIT: case Command::NEXT:
+            case Command::PREVIOUS: case Command::COUNT: case Command::TOPK: case Command::NEXTN: case Command::TOTAL:
+                return true;
+            default:
+                return false;
+            }
+        }
+        /*
+            Run a command for which is_read_only is true, like execute does. This is safe to call from several
+            threads at once.
+        */
+        template <typename Sink>
+        void execute_read_only(Command const& cmd, Sink& sink) const {
+            uint64_t const* a = cmd.args;
+            switch (cmd.op) {
+            case Command::INRANGE: inrange(a[0], a[1], UINT64_MAX, sink); break;
+            case Command::INRANGE_LIMIT: inrange(a[0], a[1], a[2], sink); break;
+            case Command::NEXT: next(a[0], sink); break;
+            case Command::NEXTN: nextn(a[0], a[1], sink); break;
+            case Command::PREVIOUS: previous(a[0], sink); break;
+            case Command::COUNT: count(a[0], sink); break;
+            case Command::TOPK: topk(a[0], a[1], a[2], sink); break;
+            case Command::TOTAL: total(a[0], a[1], sink); break;
+            default: break;
+            }
+        }
+        bool run_cmd(std::string const& line) {
+            //run a command, printing its result to stdout; returns false if the command was quit
+            return run_cmd(line, std::cout);
+        }
+        bool run_cmd(std::string const& line, std::ostream& out) {
             //get input lines, parse them, then run the associated commands with given parameters
-            str_list parts;
-            split(line, " ", parts);
-            if (parts.size() == 0) return;
-            std::string cmd = str_to_lcase(parts[0]);
+            Command cmd;
+            TextSink sink(out);
             try {
-                if (cmd == "increase") {
-                    increase(parts);
-                } else if (cmd == "reduce") {
-                    reduce(parts);
-                } else if (cmd == "inrange") {
-                    inrange(parts);
-                } else if (cmd == "next") {
-                    next(parts);
-                } else if (cmd == "previous") {
-                    previous(parts);
-                } else if (cmd == "count") {
-                    count(parts);
-                } else if (cmd == "quit") {
-                    exit(0);
+                if (parse(line, cmd)) {
+                    if (cmd.op == Command::QUIT)
+                        return false;
+                    execute(cmd, sink);
                 }
             } catch (std::exception& e) {
-                std::cout << "Exception: " << e.what() << std::endl;
+                out << "Exception: " << e.what() << '\n';
             }
+            out.flush();
+            return true;
         }
     };
+
+    typedef BasicDriver<EventCounter> Driver;
+    typedef BasicDriver<WavlEventCounter> WavlDriver;
 }
 
 #endif
@@ -0,0 +1,87 @@
+/*
+    Compares the counter's tree engines (AVL and WAVL) on a delete-heavy workload: a counter is loaded with K
+    IDs, then N operations are run, each either an increase of a random ID (inserting it if absent) or a reduce
+    of a random ID down to zero (removing it if present). Both engines run the same operations; the tool checks
+    they gave the same answers and reports the throughput and the number of rotations of each.
+
+    usage: enginebench [--keys K] [--ops N] [--removes PERCENT] [--seed S]
+*/
+#define _DEBUG_ false
+
+#include <iostream>
+#include <string>
+#include <vector>
+#include <chrono>
+#include <random>
+#include "event_counter.h"
+
+using namespace cop5536;
+
+struct Options {
+    size_t keys;
+    size_t ops;
+    unsigned removes_percent;
+    unsigned seed;
+    Options(): keys(1000000), ops(4000000), removes_percent(50), seed(1) {}
+};
+
+struct Operation {
+    bool is_remove;
+    EventCounter::key_type id;
+    EventCounter::value_type m;
+};
+
+template <typename Counter>
+void run(std::string const& name, EventCounter::kv_list const& kvs, std::vector<Operation> const& ops) {
+    Counter counter(kvs);
+    uint64_t checksum = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (Operation const& op: ops)
+        checksum = checksum * 31 + (op.is_remove ? counter.reduce(op.id, op.m) : counter.increase(op.id, op.m));
+    double elapsed_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cout << name << ": " << ops.size() << " operations in " << elapsed_s << " s, "
+              << static_cast<uint64_t>(ops.size() / elapsed_s) << " operations/s, "
+              << counter.rotations() << " rotations (" << static_cast<double>(counter.rotations()) / ops.size()
+              << " per operation), checksum " << checksum << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    Options opts;
+    for (int i = 1; i < argc; ++i) {
+        std::string opt(argv[i]);
+        if (opt == "--keys" && i + 1 < argc) {
+            opts.keys = std::stoull(argv[++i]);
+        } else if (opt == "--ops" && i + 1 < argc) {
+            opts.ops = std::stoull(argv[++i]);
+        } else if (opt == "--removes" && i + 1 < argc) {
+            opts.removes_percent = std::stoul(argv[++i]);
+        } else if (opt == "--seed" && i + 1 < argc) {
+            opts.seed = std::stoul(argv[++i]);
+        } else {
+            std::cout << "usage: enginebench [--keys K] [--ops N] [--removes PERCENT] [--seed S]" << std::endl;
+            return 1;
+        }
+    }
+    if (opts.keys == 0) {
+        std::cout << "--keys must be at least 1" << std::endl;
+        return 1;
+    }
+    //IDs are drawn from twice the initial key count, so about half of them are present at any time, and the
+    //counter's size stays roughly level while IDs keep coming and going
+    std::mt19937_64 rng(opts.seed);
+    EventCounter::key_type id_space = 2 * opts.keys;
+    EventCounter::kv_list kvs;
+    kvs.reserve(opts.keys);
+    for (EventCounter::key_type id = 1; id <= id_space; id += 2)
+        kvs.push_back(EventCounter::kv_pair(id, 1 + rng() % 100));
+    std::vector<Operation> ops(opts.ops);
+    for (Operation& op: ops) {
+        op.is_remove = rng() % 100 < opts.removes_percent;
+        op.id = 1 + rng() % id_space;
+        op.m = op.is_remove ? UINT64_MAX : 1 + rng() % 100;
+    }
+    run<EventCounter>("avl ", kvs, ops);
+    run<WavlEventCounter>("wavl", kvs, ops);
+    return 0;
+}
@@ -5,10 +5,16 @@
 #include <sstream>
 #include <string>
 #include <iostream>
+#include <queue>
 #include "avl.h"
+#include "wavl.h"
 
 namespace cop5536 {
-    class EventCounter: private AVL {
+    template <typename Tree>
+    class BasicEventCounter: private Tree {
+    /*
+        The event counter, on top of a balanced tree engine: AVL, or WAVL for workloads that remove a lot.
+    */
     public:
         using key_type = BST::key_type;
         using value_type = BST::value_type;
@@ -16,51 +22,57 @@ namespace cop5536 {
         using kv_list = BST::kv_list;
         typedef std::vector<value_type> value_list;
     private:
-        using super = AVL;
+        using super = Tree;
         using typename super::Node;
-        bool do_find_next(size_t subtree_root_index, const key_type& search_k, key_type& found_k, value_type& found_v, size_t& nodes_visited) {
-            nodes_visited = nodes_visited + 1;
-            //do in-order traversal to find the first key which is greater than search_k, while skipping subtrees that can't possibly contain a match
-            if (subtree_root_index == 0)
-                return false;
-            Node const& subtree_root = nodes[subtree_root_index];
-            //only search the left subtree if it might contain a key which is greater than search_k
-            if (subtree_root.key > search_k) {
-                //get smallest left subtree child
-                bool found = do_find_next(subtree_root.left_index, search_k, found_k, found_v, nodes_visited);
-                if (found)
-                    return true;
-                //everything in left subtree was less than or equal to search_k, so current node is the first
-                //node greater than search_k
-                found_k = subtree_root.key;
-                found_v = subtree_root.value;
-                return true;
+        using super::nodes;
+        using super::root_index;
+        using super::search;
+        using super::insert;
+        using super::remove;
+        size_t find_next_index(const key_type& search_k) const {
+            //descend once to the first key which is greater than search_k; if search_k itself is in the tree and
+            //the in-order links are on, its successor link gives the answer without going any further down
+            size_t found_index = 0;
+            size_t subtree_root_index = root_index;
+            while (subtree_root_index != 0) {
+                Node const& subtree_root = nodes[subtree_root_index];
+                if (subtree_root.key > search_k) {
+                    found_index = subtree_root_index;
+                    subtree_root_index = subtree_root.left_index;
+                } else if (subtree_root.key < search_k) {
+                    subtree_root_index = subtree_root.right_index;
+                } else {
+#if _INORDER_LINKS_
+                    return subtree_root.next_index;
+#else
+                    subtree_root_index = subtree_root.right_index;
+#endif
+                }
             }
-            //current node was smaller than or equal to the search key, so check the right subtree
-            return do_find_next(subtree_root.right_index, search_k, found_k, found_v, nodes_visited);
+            return found_index;
         }
-        bool do_find_previous(size_t subtree_root_index, const key_type& search_k, key_type& found_k, value_type& found_v, size_t& nodes_visited) {
-            nodes_visited = nodes_visited + 1;
-            //do in-order traversal backwards to find the first key which is less than search_k, while skipping subtrees that can't possibly contain a match
-            if (subtree_root_index == 0)
-                return false;
-            Node const& subtree_root = nodes[subtree_root_index];
-            //only search the right subtree if it might contain a key which is less than search_k
-            if (subtree_root.key < search_k) {
-                //get largest right subtree child
-                bool found = do_find_previous(subtree_root.right_index, search_k, found_k, found_v, nodes_visited);
-                if (found)
-                    return found;
-                //everything in right subtree was greater than or equal to search_k, so current node is the first
-                //node less than search_k
-                found_k = subtree_root.key;
-                found_v = subtree_root.value;
-                return true;
+        size_t find_previous_index(const key_type& search_k) const {
+            //mirror image of find_next_index, for the last key which is less than search_k
+            size_t found_index = 0;
+            size_t subtree_root_index = root_index;
+            while (subtree_root_index != 0) {
+                Node const& subtree_root = nodes[subtree_root_index];
+                if (subtree_root.key < search_k) {
+                    found_index = subtree_root_index;
+                    subtree_root_index = subtree_root.right_index;
+                } else if (subtree_root.key > search_k) {
+                    subtree_root_index = subtree_root.left_index;
+                } else {
+#if _INORDER_LINKS_
+                    return subtree_root.prev_index;
+#else
+                    subtree_root_index = subtree_root.left_index;
+#endif
+                }
             }
-            //current node was greater than or equal to the search key, so check the left subtree
-            return do_find_previous(subtree_root.left_index, search_k, found_k, found_v, nodes_visited);
+            return found_index;
         }
-        void do_in_range(size_t subtree_root_index, const key_type& k_l, const key_type& k_r, value_list& values, size_t& nodes_visited) {
+        void do_in_range(size_t subtree_root_index, const key_type& k_l, const key_type& k_r, value_list& values, size_t& nodes_visited) const {
             //do in-order traversal to find keys which are between k_l and k_r (inclusive), while skipping subtrees that can't possibly contain a match
             nodes_visited = nodes_visited + 1;
             if (subtree_root_index == 0)
@@ -74,9 +86,109 @@ namespace cop5536 {
             if (subtree_root.key <= k_r)
                 do_in_range(subtree_root.right_index, k_l, k_r, values, nodes_visited);
         }
+        struct TopKCandidate {
+            //either a single node, or a whole subtree whose values are bounded by the subtree max
+            value_type bound;
+            key_type min_key; //no key this candidate can yield is smaller than this, used to break ties by lowest ID
+            size_t index;
+            bool is_subtree;
+            TopKCandidate(value_type bound, key_type min_key, size_t index, bool is_subtree):
+                bound(bound), min_key(min_key), index(index), is_subtree(is_subtree) {}
+            bool operator<(TopKCandidate const& other) const {
+                //std::priority_queue pops the greatest element, so "less than" means "yielded later"
+                if (bound != other.bound)
+                    return bound < other.bound;
+                if (min_key != other.min_key)
+                    return min_key > other.min_key;
+                return is_subtree && ! other.is_subtree;
+            }
+        };
     public:
-        EventCounter(size_t init_capacity): super(init_capacity) {}
-        EventCounter(kv_list init_kvs): super(init_kvs) {}
+        /*
+            Lazily walks the (id, count) pairs of a key range in ascending key order. After a single O(log n)
+            seek, the cursor follows the nodes' successor links if _INORDER_LINKS_ is on, so it holds no more than
+            the current node; otherwise it holds the path from the root to the current node, which keeps memory
+            to O(log n) no matter how wide the range is.
+            The cursor is invalidated by any operation that modifies the counter.
+        */
+        class RangeCursor {
+        private:
+            friend class BasicEventCounter;
+            BasicEventCounter const* ec;
+            key_type k_r;
+#if _INORDER_LINKS_
+            size_t at; //current node, or 0 past the largest key
+#else
+            std::vector<size_t> path; //nodes whose left subtree has been (or is being) visited, deepest last
+#endif
+            RangeCursor(BasicEventCounter const* ec, key_type k_l, bool include_k_l, key_type k_r): ec(ec), k_r(k_r) {
+                //seek to the first key which is greater than k_l (or equal to it, if include_k_l), remembering
+                //every node we branched left at since those are the in-order successors still to be visited
+#if _INORDER_LINKS_
+                at = 0;
+#endif
+                size_t subtree_root_index = ec->root_index;
+                while (subtree_root_index != 0) {
+                    Node const& subtree_root = ec->nodes[subtree_root_index];
+                    if (subtree_root.key > k_l || (include_k_l && subtree_root.key == k_l)) {
+#if _INORDER_LINKS_
+                        at = subtree_root_index;
+#else
+                        path.push_back(subtree_root_index);
+#endif
+                        subtree_root_index = subtree_root.left_index;
+                    } else {
+                        subtree_root_index = subtree_root.right_index;
+                    }
+                }
+            }
+            size_t current_index() const {
+#if _INORDER_LINKS_
+                return at;
+#else
+                return path.empty() ? 0 : path.back();
+#endif
+            }
+        public:
+            /*
+            Return true IFF the cursor points at a pair whose key is within the range.
+            */
+            bool valid() const {
+                size_t at = current_index();
+                return at != 0 && ec->nodes[at].key <= k_r;
+            }
+            key_type key() const {
+                return ec->nodes[current_index()].key;
+            }
+            value_type value() const {
+                return ec->nodes[current_index()].value;
+            }
+            /*
+            Move to the next pair in key order, in O(1) time (amortized, without the in-order links).
+            */
+            void advance() {
+#if _INORDER_LINKS_
+                at = ec->nodes[at].next_index;
+#else
+                size_t subtree_root_index = ec->nodes[path.back()].right_index;
+                path.pop_back();
+                //the successor is the leftmost node of the right subtree, if there is one
+                while (subtree_root_index != 0) {
+                    path.push_back(subtree_root_index);
+                    subtree_root_index = ec->nodes[subtree_root_index].left_index;
+                }
+#endif
+            }
+        };
+
+        BasicEventCounter(size_t init_capacity): super(init_capacity) {}
+        BasicEventCounter(kv_list const& init_kvs): super(init_kvs) {}
+        using super::rotations;
+        using super::start_sorted_build;
+        using super::add_sorted;
+        using super::finish_sorted_build;
+        using super::size;
+        using super::back_with_file;
 
         /*
         Increase the count of the event ID by m. If ID is not present, insert it.
@@ -112,44 +224,140 @@ namespace cop5536 {
         /*
         Return ID and count of the event with lowest ID that is greater than ID. Return “0 0” if there is no next ID.
         */
-        kv_pair next(key_type id) {
-            key_type found_k(0);
-            value_type found_v(0);
-            size_t nodes_visited = 0;
-            do_find_next(root_index, id, found_k, found_v, nodes_visited);
-            kv_pair match(found_k, found_v);
-            return match;
+        kv_pair next(key_type id) const {
+            size_t found_index = find_next_index(id);
+            if (found_index == 0)
+                return kv_pair(0, 0);
+            return kv_pair(nodes[found_index].key, nodes[found_index].value);
         }
 
         /*
         Return ID and count of the event with greatest ID that is less than ID. Return “0 0” if there is no previous ID.
         */
-        kv_pair previous(key_type id) {
-            key_type found_k(0);
-            value_type found_v(0);
-            size_t nodes_visited = 0;
-            do_find_previous(root_index, id, found_k, found_v, nodes_visited);
-            kv_pair match(found_k, found_v);
-            return match;
+        kv_pair previous(key_type id) const {
+            size_t found_index = find_previous_index(id);
+            if (found_index == 0)
+                return kv_pair(0, 0);
+            return kv_pair(nodes[found_index].key, nodes[found_index].value);
         }
 
         /*
         Return the count of ID. If not present return 0.
         */
-        uint64_t count(key_type id) {
+        uint64_t count(key_type id) const {
             value_type curr_v(0);
             search(id, curr_v);
             return curr_v;
         }
 
+        /*
+        Store the count of each of n IDs in counts, 0 for IDs not present. Rather than finishing one lookup before
+        starting the next, up to lookups_in_flight descents are interleaved: each step of a descent prefetches the
+        next node it needs and then moves on to another descent, so the cache misses of independent lookups
+        overlap instead of stalling one after another. This pays off once the tree is much larger than the cache.
+        */
+        void count_batch(key_type const* ids, size_t n, value_type* counts) const {
+            static const size_t lookups_in_flight = 8;
+            size_t lookup[lookups_in_flight]; //which of the n IDs each descent is looking up
+            size_t at[lookups_in_flight]; //node each descent visits next
+            size_t num_started = 0, num_active = 0;
+            for (; num_active != lookups_in_flight && num_started != n; ++num_active, ++num_started) {
+                lookup[num_active] = num_started;
+                at[num_active] = root_index;
+            }
+            while (num_active != 0) {
+                for (size_t d = 0; d < num_active; ) {
+                    size_t index = at[d];
+                    key_type id = ids[lookup[d]];
+                    bool done = true;
+                    if (index == 0) {
+                        counts[lookup[d]] = 0;
+                    } else if (id == nodes[index].key) {
+                        counts[lookup[d]] = nodes[index].value;
+                    } else {
+                        at[d] = id < nodes[index].key ? nodes[index].left_index : nodes[index].right_index;
+                        __builtin_prefetch(&nodes[at[d]]);
+                        done = false;
+                    }
+                    if ( ! done) {
+                        ++d;
+                    } else if (num_started != n) {
+                        //reuse this descent for the next ID, starting back at the root
+                        lookup[d] = num_started++;
+                        at[d] = root_index;
+                    } else {
+                        //no IDs left to start, so retire the descent by moving the last active one into its place
+                        --num_active;
+                        lookup[d] = lookup[num_active];
+                        at[d] = at[num_active];
+                    }
+                }
+            }
+        }
+
         /*
         Return the total count for IDs between ID1 and ID2 inclusively. Note ID1 ≤ ID2 .
         */
-        void in_range(key_type id1, key_type id2, value_list& values) {
+        void in_range(key_type id1, key_type id2, value_list& values) const {
             size_t nodes_visited = 0;
             do_in_range(root_index, id1, id2, values, nodes_visited);
         }
+
+        /*
+        Return the sum of the counts of IDs between ID1 and ID2 inclusively. Note ID1 ≤ ID2 .
+        This walks the range, so it takes time linear in the number of IDs in it.
+        */
+        value_type total(key_type id1, key_type id2) const {
+            value_type sum = 0;
+            for (RangeCursor cursor = range(id1, id2); cursor.valid(); cursor.advance())
+                sum += cursor.value();
+            return sum;
+        }
+
+        /*
+        Return up to k (ID, count) pairs with the largest counts among IDs between ID1 and ID2 inclusively,
+        largest count first and lowest ID first among equal counts. Note ID1 ≤ ID2 .
+        This is a best-first search over subtree max counts, so it visits O(k + log n) nodes.
+        */
+        void top_k(key_type id1, key_type id2, size_t k, kv_list& top) const {
+            std::priority_queue<TopKCandidate> candidates;
+            if (root_index != 0)
+                candidates.push(TopKCandidate(nodes[root_index].max_value, id1, root_index, true));
+            while ( ! candidates.empty() && top.size() < k) {
+                TopKCandidate best = candidates.top();
+                candidates.pop();
+                Node const& n = nodes[best.index];
+                if ( ! best.is_subtree) {
+                    //nothing left in the queue can beat this node
+                    top.push_back(kv_pair(n.key, n.value));
+                    continue;
+                }
+                //split the subtree into its root and its children, skipping children that lie entirely outside the range
+                if (n.key >= id1 && n.key <= id2)
+                    candidates.push(TopKCandidate(n.value, n.key, best.index, false));
+                if (n.left_index && n.key > id1)
+                    candidates.push(TopKCandidate(nodes[n.left_index].max_value, best.min_key, n.left_index, true));
+                if (n.right_index && n.key < id2)
+                    candidates.push(TopKCandidate(nodes[n.right_index].max_value, std::max(best.min_key, n.key + 1), n.right_index, true));
+            }
+        }
+
+        /*
+        Return a cursor positioned at the first ID between ID1 and ID2 inclusively. Note ID1 ≤ ID2 .
+        */
+        RangeCursor range(key_type id1, key_type id2) const {
+            return RangeCursor(this, id1, true, id2);
+        }
+
+        /*
+        Return a cursor positioned at the lowest ID that is greater than ID, running to the end of the counter.
+        */
+        RangeCursor after(key_type id) const {
+            return RangeCursor(this, id, false, UINT64_MAX);
+        }
     };
+    typedef BasicEventCounter<AVL> EventCounter;
+    typedef BasicEventCounter<WAVL> WavlEventCounter;
 }
 
 #endif
@@ -0,0 +1,87 @@
+#ifndef _INPUT_FILE_H_
+#define _INPUT_FILE_H_
+
+#include <cstdlib>
+#include <cstdint>
+#include <string>
+#include <fstream>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+#include <stdexcept>
+#include "event_counter.h"
+
+namespace cop5536 {
+    /*
+        Input files hold one "id count" pair per line, in ascending ID order, optionally preceded by a line with
+        just the number of pairs, which is only used to size the tree's node array up front. Any other lines are
+        skipped. The driver and replay both load them through here, so they read every file the same way.
+    */
+    namespace input_file {
+        inline uint64_t parse_number(std::string const& token) {
+            //a whole number that fits in 64 bits, and nothing else
+            uint64_t n = 0;
+            for (char c: token) {
+                uint64_t digit = c - '0';
+                if (c < '0' || c > '9')
+                    throw std::invalid_argument("\"" + token + "\" is not a whole number");
+                if (n > (UINT64_MAX - digit) / 10)
+                    throw std::out_of_range("\"" + token + "\" is too large");
+                n = n * 10 + digit;
+            }
+            return n;
+        }
+
+        /*
+            Stream the pairs in the file called name straight into the node array of ec, an event counter on
+            any tree engine, and set max_id to the largest ID among them. Returns false, having printed why, if
+            the file can't be opened or holds a malformed number or a pair out of order, in which case ec is
+            left empty.
+        */
+        template <typename Counter>
+        bool load(std::string const& name, Counter& ec, uint64_t& max_id) {
+            std::ifstream in(name);
+            if ( ! in.is_open()) {
+                std::cout << "Could not open input file " << name << std::endl;
+                return false;
+            }
+            std::string line, tokens[3];
+            size_t line_number = 0;
+            bool started = false;
+            max_id = 0;
+            try {
+                while (std::getline(in, line)) {
+                    ++line_number;
+                    std::istringstream fields(line);
+                    size_t num_tokens = 0;
+                    while (num_tokens != 3 && fields >> tokens[num_tokens])
+                        ++num_tokens;
+                    if (num_tokens == 1 && ! started) {
+                        ec.start_sorted_build(parse_number(tokens[0]));
+                        started = true;
+                    } else if (num_tokens == 2) {
+                        if ( ! started) {
+                            ec.start_sorted_build(0);
+                            started = true;
+                        }
+                        uint64_t id = parse_number(tokens[0]);
+                        ec.add_sorted(id, parse_number(tokens[1]));
+                        max_id = std::max(max_id, id);
+                    }
+                }
+            } catch (std::exception& e) {
+                std::cout << "Could not load input file " << name << ", line " << line_number << ": " << e.what() << std::endl;
+                ec.start_sorted_build(0);
+                ec.finish_sorted_build();
+                max_id = 0;
+                return false;
+            }
+            if ( ! started)
+                ec.start_sorted_build(0);
+            ec.finish_sorted_build();
+            return true;
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,190 @@
+/*
+    Load generator for bbst's server mode. Opens a number of client connections, each of which keeps a fixed
+    number of commands in flight, sending a new one as each response arrives, and reports overall throughput and
+    the latency distribution of individual commands (from the moment each was written until its response line
+    arrived).
+
+    usage: loadgen (--unix PATH | --tcp PORT) [--connections C] [--depth D] [--requests N] [--keys K] [--writes PERCENT]
+*/
+#include <iostream>
+#include <string>
+#include <vector>
+#include <deque>
+#include <thread>
+#include <chrono>
+#include <random>
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+typedef std::chrono::steady_clock clock_type;
+
+struct Options {
+    std::string unix_path;
+    uint16_t tcp_port;
+    size_t connections;
+    size_t depth;
+    size_t requests; //per connection
+    uint64_t keys;
+    unsigned writes_percent;
+    Options(): tcp_port(0), connections(4), depth(32), requests(100000), keys(1000000), writes_percent(10) {}
+};
+
+int connect_to_server(Options const& opts) {
+    int fd;
+    if ( ! opts.unix_path.empty()) {
+        sockaddr_un addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sun_family = AF_UNIX;
+        strncpy(addr.sun_path, opts.unix_path.c_str(), sizeof(addr.sun_path) - 1);
+        fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0)
+            throw std::runtime_error(std::string("connect: ") + strerror(errno));
+    } else {
+        sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(opts.tcp_port);
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0 || connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0)
+            throw std::runtime_error(std::string("connect: ") + strerror(errno));
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    return fd;
+}
+
+void send_all(int fd, std::string const& data) {
+    for (size_t written = 0; written < data.size(); ) {
+        ssize_t n = send(fd, data.data() + written, data.size() - written, MSG_NOSIGNAL);
+        if (n < 0)
+            throw std::runtime_error(std::string("send: ") + strerror(errno));
+        written += n;
+    }
+}
+
+void run_client(Options const& opts, unsigned seed, std::vector<double>& latencies_us) {
+    //keep opts.depth commands in flight: fill the window, then send one more command for every response line
+    int fd = connect_to_server(opts);
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<uint64_t> key_dist(0, opts.keys - 1);
+    std::uniform_int_distribution<unsigned> percent_dist(0, 99);
+    std::deque<clock_type::time_point> sent_at; //when each command still in flight was written, oldest first
+    std::string to_send;
+    char buf[64 * 1024];
+    size_t sent = 0;
+    auto send_commands = [&](size_t n) {
+        //write up to n more commands, all at once
+        to_send.clear();
+        size_t num_new = 0;
+        for (; num_new != n && sent < opts.requests; ++num_new, ++sent) {
+            uint64_t id = key_dist(rng);
+            if (percent_dist(rng) < opts.writes_percent)
+                to_send += "increase " + std::to_string(id) + " 1\n";
+            else
+                to_send += "count " + std::to_string(id) + "\n";
+        }
+        if (num_new == 0)
+            return;
+        sent_at.insert(sent_at.end(), num_new, clock_type::now());
+        send_all(fd, to_send);
+    };
+    latencies_us.reserve(opts.requests);
+    send_commands(opts.depth);
+    while ( ! sent_at.empty()) {
+        ssize_t n = recv(fd, buf, sizeof(buf), 0);
+        if (n <= 0)
+            throw std::runtime_error("Server closed the connection early");
+        clock_type::time_point now = clock_type::now();
+        size_t num_answered = 0;
+        for (ssize_t i = 0; i < n; ++i) {
+            if (buf[i] == '\n') {
+                latencies_us.push_back(std::chrono::duration<double, std::micro>(now - sent_at.front()).count());
+                sent_at.pop_front();
+                ++num_answered;
+            }
+        }
+        send_commands(num_answered);
+    }
+    close(fd);
+}
+
+double percentile(std::vector<double> const& sorted, double p) {
+    if (sorted.empty())
+        return 0;
+    size_t idx = static_cast<size_t>(p / 100.0 * (sorted.size() - 1));
+    return sorted[idx];
+}
+
+int main(int argc, char* argv[]) {
+    Options opts;
+    for (int i = 1; i < argc; ++i) {
+        std::string opt(argv[i]);
+        if (i + 1 >= argc) {
+            std::cout << "Missing value for option " << opt << std::endl;
+            return 1;
+        }
+        std::string val(argv[++i]);
+        if (opt == "--unix")
+            opts.unix_path = val;
+        else if (opt == "--tcp")
+            opts.tcp_port = std::stoul(val);
+        else if (opt == "--connections")
+            opts.connections = std::stoull(val);
+        else if (opt == "--depth")
+            opts.depth = std::stoull(val);
+        else if (opt == "--requests")
+            opts.requests = std::stoull(val);
+        else if (opt == "--keys")
+            opts.keys = std::stoull(val);
+        else if (opt == "--writes")
+            opts.writes_percent = std::stoul(val);
+        else {
+            std::cout << "Unrecognized option " << opt << std::endl;
+            return 1;
+        }
+    }
+    if (opts.unix_path.empty() && opts.tcp_port == 0) {
+        std::cout << "Expected --unix PATH or --tcp PORT" << std::endl;
+        return 1;
+    }
+    if (opts.connections == 0 || opts.depth == 0 || opts.keys == 0) {
+        std::cout << "--connections, --depth and --keys must be at least 1" << std::endl;
+        return 1;
+    }
+
+    std::vector<std::vector<double> > latencies(opts.connections);
+    std::vector<std::thread> clients;
+    clock_type::time_point start = clock_type::now();
+    for (size_t c = 0; c < opts.connections; ++c) {
+        clients.push_back(std::thread([&opts, &latencies, c]() {
+            try {
+                run_client(opts, 12345 + c, latencies[c]);
+            } catch (std::exception& e) {
+                std::cerr << "Client " << c << ": " << e.what() << std::endl;
+            }
+        }));
+    }
+    for (std::thread& t: clients)
+        t.join();
+    double elapsed_s = std::chrono::duration<double>(clock_type::now() - start).count();
+
+    std::vector<double> all;
+    for (std::vector<double> const& l: latencies)
+        all.insert(all.end(), l.begin(), l.end());
+    std::sort(all.begin(), all.end());
+    std::cout << "connections " << opts.connections << ", depth " << opts.depth << ", "
+              << all.size() << " commands in " << elapsed_s << " s" << std::endl;
+    std::cout << "throughput " << static_cast<uint64_t>(all.size() / elapsed_s) << " commands/s" << std::endl;
+    std::cout << "latency us: p50 " << percentile(all, 50) << ", p99 " << percentile(all, 99)
+              << ", p99.9 " << percentile(all, 99.9) << ", max " << (all.empty() ? 0 : all.back()) << std::endl;
+    return all.size() == opts.connections * opts.requests ? 0 : 1;
+}
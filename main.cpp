@@ -1,22 +1,129 @@
 #define _DEBUG_ false
 
 #include "driver.h"
+#include "server.h"
+#include "pipeline.h"
+#include "batch_runner.h"
 
-int main( int argc, char* argv[] )
+struct Options {
+    //the optional mode switches that follow the input file name
+    std::string engine;
+    uint64_t window;
+    bool approximate;
+    size_t sketch_budget_bytes;
+    uint64_t promote_threshold;
+    std::string serve_unix;
+    uint16_t serve_tcp;
+    bool pipelined;
+    size_t num_threads;
+    std::string arena_file;
+    Options(): engine("avl"), window(0), approximate(false), sketch_budget_bytes(0), promote_threshold(0), serve_tcp(0), pipelined(false), num_threads(1) {}
+};
+
+template <typename Driver>
+int run(std::string const& inp_f, Options const& opts)
 {
-    if (argc != 2) {
-        std::cout << "Expected first argument to be the input file name" << std::endl;
-        return 1;
+    Driver driver;
+    driver.set_window(opts.window);
+    if (opts.approximate) {
+        try {
+            driver.set_approximate(opts.sketch_budget_bytes, opts.promote_threshold);
+        } catch (std::exception& e) {
+            std::cout << "Invalid value for --approx: " << e.what() << std::endl;
+            return 1;
+        }
     }
-    std::string inp_f(argv[1]);
-    cop5536::Driver driver;
+    driver.set_arena_file(opts.arena_file);
     if ( ! driver.load_file(inp_f))
         return 1;
+    if ( ! opts.serve_unix.empty() || opts.serve_tcp != 0) {
+        //load once, then answer commands from socket clients instead of stdin
+        try {
+            cop5536::BasicServer<Driver> server(driver);
+            if ( ! opts.serve_unix.empty())
+                server.listen_unix(opts.serve_unix);
+            else
+                server.listen_tcp(opts.serve_tcp);
+            server.run();
+        } catch (std::exception& e) {
+            std::cout << "Could not serve clients: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+    if (opts.num_threads > 1) {
+        //run runs of read-only commands in parallel; the standard streams are only used by this thread
+        std::ios::sync_with_stdio(false);
+        cop5536::BasicBatchRunner<Driver> runner(driver, opts.num_threads);
+        runner.run(std::cin, std::cout);
+        return 0;
+    }
+    if (opts.pipelined) {
+        //parse, execute and print on separate threads; the standard streams are only used through
+        //the pipeline from here on, so they no longer need to stay in step with C stdio
+        std::ios::sync_with_stdio(false);
+        cop5536::BasicPipeline<Driver> pipeline(driver);
+        pipeline.run(std::cin, std::cout);
+        return 0;
+    }
     while(true) {
         //the only point of main.cpp is to instantiate the driver with the input file and then pass input lines to it
         std::string line;
-        std::getline(std::cin, line);
-        driver.run_cmd(line);
+        if ( ! std::getline(std::cin, line) || ! driver.run_cmd(line))
+            break;
     }
     return 0;
 }
+
+int main( int argc, char* argv[] )
+{
+    if (argc < 2) {
+        std::cout << "Expected first argument to be the input file name" << std::endl;
+        return 1;
+    }
+    std::string inp_f(argv[1]);
+    Options opts;
+    for (int i = 2; i < argc; ++i) {
+        std::string opt(argv[i]);
+        try {
+            if (opt == "--engine" && i + 1 < argc) {
+                opts.engine = argv[++i];
+                if (opts.engine != "avl" && opts.engine != "wavl")
+                    throw std::invalid_argument("the engines are avl and wavl");
+            } else if (opt == "--window" && i + 1 < argc) {
+                opts.window = cop5536::input_file::parse_number(argv[++i]);
+            } else if (opt == "--approx" && i + 2 < argc) {
+                opts.approximate = true;
+                opts.sketch_budget_bytes = cop5536::input_file::parse_number(argv[++i]);
+                opts.promote_threshold = cop5536::input_file::parse_number(argv[++i]);
+            } else if (opt == "--serve-unix" && i + 1 < argc) {
+                opts.serve_unix = argv[++i];
+            } else if (opt == "--serve-tcp" && i + 1 < argc) {
+                uint64_t port = cop5536::input_file::parse_number(argv[++i]);
+                if (port == 0 || port > UINT16_MAX)
+                    throw std::out_of_range("TCP ports go from 1 to 65535");
+                opts.serve_tcp = port;
+            } else if (opt == "--pipeline") {
+                opts.pipelined = true;
+            } else if (opt == "--threads" && i + 1 < argc) {
+                opts.num_threads = cop5536::input_file::parse_number(argv[++i]);
+            } else if (opt == "--arena-file" && i + 1 < argc) {
+                opts.arena_file = argv[++i];
+            } else {
+                std::cout << "Unrecognized option " << opt << std::endl;
+                return 1;
+            }
+        } catch (std::exception& e) {
+            std::cout << "Invalid value for " << opt << ": " << e.what() << std::endl;
+            return 1;
+        }
+    }
+    if (opts.pipelined && opts.num_threads > 1) {
+        //the two are separate ways of running stdin, and neither can run inside the other
+        std::cout << "--pipeline and --threads can't be used together" << std::endl;
+        return 1;
+    }
+    //the tree engine is a template parameter of the driver and everything that runs it, so pick an instantiation
+    if (opts.engine == "wavl")
+        return run<cop5536::WavlDriver>(inp_f, opts);
+    return run<cop5536::Driver>(inp_f, opts);
+}
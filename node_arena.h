@@ -0,0 +1,225 @@
+#ifndef _NODE_ARENA_H_
+#define _NODE_ARENA_H_
+
+#include <cstdlib>
+#include <cstring>
+#include <cerrno>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <stdexcept>
+#include <type_traits>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace cop5536 {
+    template <typename T>
+    class NodeArena {
+    /*
+        A resizable array of T, mapped straight from the kernel rather than allocated with new[]. Growing it is a
+        single mremap, which moves page mappings instead of copying, so the old and new arrays never both exist.
+        The array can live in anonymous memory, or in a file, which lets it grow past physical memory: only the
+        pages being touched need to be resident, and the kernel writes the others back to the file and evicts
+        them as it needs room. The file is scratch space of the arena's own: it is always newly created, never an
+        existing file, it is truncated when the arena is reset, and it has no name once it has been opened, so
+        nothing is left behind.
+
+        Fresh slots are all zero bytes, so T must be trivially copyable, with all-zero bytes as its default
+        state.
+    */
+    public:
+        enum Access {
+            NORMAL, //no particular pattern
+            SEQUENTIAL, //front to back, e.g. while streaming in a sorted load; read ahead, and drop pages once read
+            RANDOM //scattered, e.g. tree descents; don't read ahead around each fault
+        };
+    private:
+        T* items;
+        size_t num_items;
+        int fd; //backing file, or -1 for anonymous memory
+        Access access; //how the whole array is expected to be accessed, passed on to the kernel
+        size_t num_locked; //items at the front that are locked in memory
+
+        static size_t bytes_for(size_t n) {
+            return n * sizeof(T);
+        }
+        static void fail(std::string const& call) {
+            throw std::runtime_error(call + ": " + strerror(errno));
+        }
+        void map(size_t n) {
+            //map a fresh array of n items; a file is first cut back to zero, so every item reads as zero bytes
+            if (fd != -1 && (ftruncate(fd, 0) != 0 || ftruncate(fd, bytes_for(n)) != 0))
+                fail("ftruncate");
+            void* p = fd == -1
+                ? mmap(nullptr, bytes_for(n), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0)
+                : mmap(nullptr, bytes_for(n), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+            if (p == MAP_FAILED)
+                fail("mmap");
+            items = static_cast<T*>(p);
+            num_items = n;
+            apply_access();
+        }
+        void apply_access() const {
+            int advice = access == SEQUENTIAL ? MADV_SEQUENTIAL : access == RANDOM ? MADV_RANDOM : MADV_NORMAL;
+            if (items != nullptr)
+                madvise(items, bytes_for(num_items), advice);
+        }
+        void unmap() {
+            if (items != nullptr)
+                munmap(items, bytes_for(num_items));
+            items = nullptr;
+            num_items = 0;
+            num_locked = 0;
+        }
+        static int open_scratch_file(std::string const& path) {
+            //a new file with no name, inside path if it is a directory, or else at path, which must not exist yet
+            struct stat st;
+            if (stat(path.c_str(), &st) == 0 && S_ISDIR(st.st_mode)) {
+#ifdef O_TMPFILE
+                int unnamed_fd = open(path.c_str(), O_RDWR | O_TMPFILE | O_EXCL, 0600);
+                if (unnamed_fd != -1)
+                    return unnamed_fd;
+#endif
+                //the file system can't make unnamed files, so make one with a unique name and remove the name
+                std::string name_pattern = path + "/arena.XXXXXX";
+                std::vector<char> name(name_pattern.begin(), name_pattern.end());
+                name.push_back('\0');
+                int fd = mkstemp(name.data());
+                if (fd == -1)
+                    fail("mkstemp " + name_pattern);
+                unlink(name.data());
+                return fd;
+            }
+            int fd = open(path.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+            if (fd == -1)
+                fail("open " + path);
+            //the file only needs to outlive the mapping, not the process
+            unlink(path.c_str());
+            return fd;
+        }
+        void release() {
+            items = nullptr;
+            num_items = 0;
+            fd = -1;
+            num_locked = 0;
+        }
+    public:
+        static_assert(std::is_trivially_copyable<T>::value, "arena items are moved around as raw bytes");
+
+        NodeArena(): items(nullptr), num_items(0), fd(-1), access(NORMAL), num_locked(0) {}
+        NodeArena(NodeArena const&) = delete;
+        NodeArena& operator=(NodeArena const&) = delete;
+        NodeArena(NodeArena&& other): items(other.items), num_items(other.num_items), fd(other.fd), access(other.access), num_locked(other.num_locked) {
+            other.release();
+        }
+        NodeArena& operator=(NodeArena&& other) {
+            if (this != &other) {
+                unmap();
+                if (fd != -1)
+                    close(fd);
+                items = other.items;
+                num_items = other.num_items;
+                fd = other.fd;
+                access = other.access;
+                num_locked = other.num_locked;
+                other.release();
+            }
+            return *this;
+        }
+        ~NodeArena() {
+            unmap();
+            if (fd != -1)
+                close(fd);
+        }
+
+        /*
+            Keep the array in a new scratch file from now on. If path is a directory, the file is made inside
+            it; otherwise it is made at path, which must not exist yet, so no existing file is ever overwritten.
+            The current contents move over to the file.
+        */
+        void back_with_file(std::string const& path) {
+            int new_fd = open_scratch_file(path);
+            T* old_items = items;
+            size_t n = num_items;
+            items = nullptr;
+            num_items = 0;
+            int old_fd = fd;
+            fd = new_fd;
+            if (n != 0) {
+                map(n);
+                memcpy(items, old_items, bytes_for(n));
+                munmap(old_items, bytes_for(n));
+            }
+            if (old_fd != -1)
+                close(old_fd);
+        }
+        bool is_file_backed() const {
+            return fd != -1;
+        }
+
+        T* data() const {
+            return items;
+        }
+        size_t size() const {
+            return num_items;
+        }
+        /*
+            Throw away the contents, leaving n zeroed items.
+        */
+        void reset(size_t n) {
+            unmap();
+            if (n != 0)
+                map(n);
+        }
+        /*
+            Grow (or shrink) to n items, keeping the contents of the first min(n, size()) of them; any new items
+            are zero. Other pointers into the array are invalidated, as it may move.
+        */
+        void resize(size_t n) {
+            if (items == nullptr || n == 0) {
+                reset(n);
+                return;
+            }
+            if (fd != -1 && ftruncate(fd, bytes_for(n)) != 0)
+                fail("ftruncate");
+            //mremap only moves a single mapping, and locking the front splits it in two, so unlock it meanwhile
+            size_t n_to_lock = num_locked;
+            keep_resident(0);
+            void* p = mremap(items, bytes_for(num_items), bytes_for(n), MREMAP_MAYMOVE);
+            if (p == MAP_FAILED)
+                fail("mremap");
+            items = static_cast<T*>(p);
+            num_items = n;
+            apply_access();
+            keep_resident(n_to_lock);
+        }
+        /*
+            Tell the kernel how the array is about to be accessed, which decides how much it reads ahead around
+            a page fault. This holds until the next call, however the array is resized meanwhile.
+        */
+        void set_access(Access new_access) {
+            access = new_access;
+            apply_access();
+        }
+        /*
+            Read the first n items into memory now and keep them there, so they never cost a page fault. Locking
+            is best effort: past the process's locked-memory limit the pages are only read in, and from then on
+            kept resident by being used often.
+        */
+        void keep_resident(size_t n) {
+            n = std::min(n, num_items);
+            if (num_locked != 0)
+                munlock(items, bytes_for(num_locked));
+            num_locked = 0;
+            if (n == 0)
+                return;
+            madvise(items, bytes_for(n), MADV_WILLNEED);
+            if (mlock(items, bytes_for(n)) == 0)
+                num_locked = n;
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,133 @@
+#ifndef _PIPELINE_H_
+#define _PIPELINE_H_
+
+#include "driver.h"
+#include "spsc_ring.h"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+
+namespace cop5536 {
+    template <typename Driver>
+    class BasicPipeline {
+    /*
+        Runs the driver as three stages on three threads: a reader thread parses input lines into commands, the
+        calling thread executes them against the counter, and a writer thread formats the results. The stages
+        hand work along through lock-free single-producer/single-consumer rings, and each stage handles items in
+        arrival order, so the output is exactly what the plain stdin loop would have printed. Only the executor
+        touches the counter, so the tree itself needs no locking.
+    */
+    private:
+        struct ParsedCommand {
+            Command cmd;
+            bool has_error; //parsing threw, and error holds the message to print in the command's place
+            std::string error;
+        };
+        struct RingSink {
+            //hands each result to the writer thread as soon as it is complete
+            SpscRing<Result>& ring;
+            RingSink(SpscRing<Result>& ring): ring(ring) {}
+            Result& begin(Result::Kind kind) {
+                Result& r = ring.claim();
+                r.reset(kind);
+                return r;
+            }
+            void commit() {
+                ring.publish();
+            }
+        };
+        static const size_t ring_capacity = 4096;
+        static const size_t write_batch_size = 64 * 1024; //bytes of formatted output gathered before writing them out
+        Driver& driver;
+        SpscRing<ParsedCommand> commands;
+        SpscRing<Result> results;
+
+        void read_and_parse(std::istream& in) {
+            std::string line;
+            while (true) {
+                ParsedCommand& pc = commands.claim();
+                pc.has_error = false;
+                if ( ! std::getline(in, line)) {
+                    //end of input is treated as quit
+                    pc.cmd.op = Command::QUIT;
+                    commands.publish();
+                    return;
+                }
+                try {
+                    if ( ! driver.parse(line, pc.cmd))
+                        continue; //ignored line, so the slot is reused for the next one
+                } catch (std::exception& e) {
+                    pc.has_error = true;
+                    pc.error = e.what();
+                }
+                bool quit = ! pc.has_error && pc.cmd.op == Command::QUIT;
+                commands.publish();
+                if (quit)
+                    return;
+            }
+        }
+        void execute_all() {
+            RingSink sink(results);
+            while (true) {
+                ParsedCommand& pc = commands.front();
+                if ( ! pc.has_error && pc.cmd.op == Command::QUIT) {
+                    commands.release();
+                    break;
+                }
+                try {
+                    if (pc.has_error)
+                        throw std::invalid_argument(pc.error);
+                    driver.execute(pc.cmd, sink);
+                } catch (std::exception& e) {
+                    Result& r = sink.begin(Result::ERROR);
+                    r.error = e.what();
+                    sink.commit();
+                }
+                commands.release();
+            }
+            results.close();
+        }
+        void format_and_write(std::ostream& out) {
+            std::ostringstream batch;
+            while (true) {
+                if ( ! results.has_item()) {
+                    //nothing more to format right now, so let what we have go out
+                    if (batch.tellp() > 0) {
+                        out << batch.str();
+                        out.flush();
+                        batch.str("");
+                    }
+                    if ( ! results.wait())
+                        return;
+                }
+                results.front().format(batch);
+                results.release();
+                if (static_cast<size_t>(batch.tellp()) >= write_batch_size) {
+                    out << batch.str();
+                    batch.str("");
+                }
+            }
+        }
+    public:
+        BasicPipeline(Driver& driver): driver(driver), commands(ring_capacity), results(ring_capacity) {}
+        /*
+            Run every command from in until quit or the end of input, writing the responses to out.
+        */
+        void run(std::istream& in, std::ostream& out) {
+            //the writer thread owns out from here on, so reading must not flush it
+            std::ostream* tied = in.tie(nullptr);
+            std::thread reader([this, &in]() { read_and_parse(in); });
+            std::thread writer([this, &out]() { format_and_write(out); });
+            execute_all();
+            reader.join();
+            writer.join();
+            in.tie(tied);
+        }
+    };
+
+    typedef BasicPipeline<Driver> Pipeline;
+}
+
+#endif
@@ -0,0 +1,225 @@
+/*
+    Replays a binary command trace (see trace2bin) straight into an EventCounter loaded from an input file, and
+    reports the engine's throughput with no text parsing or formatting in the timed loop. The binary responses can
+    be saved, or rendered as text afterwards to check them against the expected output of the text trace.
+
+    Runs of count commands are looked up together with EventCounter::count_batch, unless --no-interleave is
+    given, so the two can be compared.
+
+    With --arena-file, the tree's nodes live in a new file at that path, or in that directory, rather than in
+    memory (see NodeArena), and the report includes the major page faults taken, which is what a counter larger
+    than memory pays for each command.
+
+    usage: replay input_file trace.bin [--responses responses.bin] [--text] [--repeat R] [--no-interleave]
+                  [--arena-file path]
+*/
+#define _DEBUG_ false
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <chrono>
+#include <sys/resource.h>
+#include "binary_protocol.h"
+#include "input_file.h"
+
+using namespace cop5536;
+
+bool read_file(std::string const& name, std::string& contents) {
+    std::ifstream in(name, std::ios::binary);
+    if ( ! in.is_open()) {
+        std::cout << "Could not open file " << name << std::endl;
+        return false;
+    }
+    std::ostringstream buf;
+    buf << in.rdbuf();
+    contents = buf.str();
+    return true;
+}
+
+bool check_trace(std::string const& name, std::string const& trace) {
+    //decode every record up front, so the timed loop can take a failed decode to mean the end of the trace
+    const char *p = trace.data(), *end = p + trace.size();
+    Command cmd;
+    while (p != end) {
+        const char* record = p;
+        if ( ! binary_protocol::decode_command(p, end, cmd)) {
+            std::cout << "Malformed or truncated record at byte offset " << record - trace.data() << " of " << name << std::endl;
+            return false;
+        }
+        if (cmd.op == Command::QUIT)
+            break;
+    }
+    return true;
+}
+
+long major_faults() {
+    //page faults so far that had to wait for the disk
+    rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_majflt;
+}
+
+void print_text(std::string const& trace, std::string const& responses) {
+    //render each binary response the way the text driver would have printed it
+    const char *cmd_p = trace.data(), *cmd_end = cmd_p + trace.size();
+    const char *resp_p = responses.data(), *resp_end = resp_p + responses.size();
+    Command cmd;
+    uint64_t a, b, n;
+    while (binary_protocol::decode_command(cmd_p, cmd_end, cmd) && cmd.op != Command::QUIT) {
+        switch (cmd.op) {
+        case Command::NEXT:
+        case Command::PREVIOUS:
+            binary_protocol::get_varint(resp_p, resp_end, a);
+            binary_protocol::get_varint(resp_p, resp_end, b);
+            std::cout << a << ' ' << b << '\n';
+            break;
+        case Command::INRANGE:
+        case Command::INRANGE_LIMIT: {
+            bool first = true;
+            binary_protocol::read_chunks(resp_p, resp_end, [&](const char*& p, const char* end) {
+                bool ok = binary_protocol::get_varint(p, end, a);
+                std::cout << (first ? "" : " ") << a;
+                first = false;
+                return ok;
+            });
+            binary_protocol::get_varint(resp_p, resp_end, b);
+            if (b) {
+                binary_protocol::get_varint(resp_p, resp_end, a);
+                std::cout << (first ? "" : " ") << "next=" << a;
+            }
+            std::cout << '\n';
+            break;
+        }
+        case Command::TOPK:
+            binary_protocol::get_varint(resp_p, resp_end, n);
+            for (uint64_t i = 0; i != n; ++i) {
+                binary_protocol::get_varint(resp_p, resp_end, a);
+                binary_protocol::get_varint(resp_p, resp_end, b);
+                std::cout << (i ? " " : "") << a << ' ' << b;
+            }
+            std::cout << '\n';
+            break;
+        case Command::NEXTN: {
+            bool first = true;
+            binary_protocol::read_chunks(resp_p, resp_end, [&](const char*& p, const char* end) {
+                bool ok = binary_protocol::get_varint(p, end, a) && binary_protocol::get_varint(p, end, b);
+                std::cout << (first ? "" : " ") << a << ' ' << b;
+                first = false;
+                return ok;
+            });
+            std::cout << '\n';
+            break;
+        }
+        case Command::INCREASE_AT:
+        case Command::TICK:
+            break; //not executed by replay, so no response
+        default:
+            binary_protocol::get_varint(resp_p, resp_end, a);
+            std::cout << a << '\n';
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc < 3) {
+        std::cout << "usage: replay input_file trace.bin [--responses responses.bin] [--text] [--repeat R] [--no-interleave] [--arena-file path]" << std::endl;
+        return 1;
+    }
+    std::string responses_f, arena_f;
+    bool text = false;
+    size_t repeat = 1;
+    bool interleave = true;
+    for (int i = 3; i < argc; ++i) {
+        std::string opt(argv[i]);
+        if (opt == "--responses" && i + 1 < argc) {
+            responses_f = argv[++i];
+        } else if (opt == "--no-interleave") {
+            interleave = false;
+        } else if (opt == "--text") {
+            text = true;
+        } else if (opt == "--repeat" && i + 1 < argc) {
+            try {
+                repeat = input_file::parse_number(argv[++i]);
+            } catch (std::exception& e) {
+                std::cout << "Invalid value for " << opt << ": " << e.what() << std::endl;
+                return 1;
+            }
+        } else if (opt == "--arena-file" && i + 1 < argc) {
+            arena_f = argv[++i];
+        } else {
+            std::cout << "Unrecognized option " << opt << std::endl;
+            return 1;
+        }
+    }
+    EventCounter ec(1);
+    if ( ! arena_f.empty()) {
+        try {
+            ec.back_with_file(arena_f);
+        } catch (std::exception& e) {
+            std::cout << "Could not use arena file: " << e.what() << std::endl;
+            return 1;
+        }
+    }
+    std::string trace;
+    uint64_t max_id;
+    if ( ! input_file::load(argv[1], ec, max_id) || ! read_file(argv[2], trace) || ! check_trace(argv[2], trace))
+        return 1;
+    std::cerr << "loaded " << ec.size() << " IDs, " << major_faults() << " major page faults" << std::endl;
+    long faults_before = major_faults();
+
+    std::string responses;
+    size_t num_executed = 0, num_unsupported = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    for (size_t r = 0; r != repeat; ++r) {
+        responses.clear();
+        const char *p = trace.data(), *end = p + trace.size();
+        Command cmd;
+        static const size_t max_count_batch = 64;
+        EventCounter::key_type ids[max_count_batch];
+        EventCounter::value_type counts[max_count_batch];
+        size_t num_counts = 0;
+        while (true) {
+            bool more = binary_protocol::decode_command(p, end, cmd) && cmd.op != Command::QUIT;
+            if (more && interleave && cmd.op == Command::COUNT) {
+                ids[num_counts++] = cmd.args[0];
+                if (num_counts != max_count_batch)
+                    continue;
+            }
+            if (num_counts != 0) {
+                //the run of counts has ended (or filled up), so look them all up together
+                ec.count_batch(ids, num_counts, counts);
+                for (size_t i = 0; i != num_counts; ++i)
+                    binary_protocol::put_varint(responses, counts[i]);
+                num_executed += num_counts;
+                num_counts = 0;
+            }
+            if ( ! more)
+                break;
+            if (cmd.op == Command::COUNT && interleave)
+                continue;
+            if (binary_protocol::execute(ec, cmd, responses))
+                ++num_executed;
+            else
+                ++num_unsupported;
+        }
+    }
+    double elapsed_s = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cerr << num_executed << " commands in " << elapsed_s << " s, "
+              << static_cast<uint64_t>(num_executed / elapsed_s) << " commands/s";
+    if (num_unsupported)
+        std::cerr << " (" << num_unsupported << " windowed commands skipped)";
+    long num_faults = major_faults() - faults_before;
+    std::cerr << ", " << num_faults << " major page faults (" << static_cast<double>(num_faults) / num_executed
+              << " per command)" << std::endl;
+    if ( ! responses_f.empty()) {
+        std::ofstream out(responses_f, std::ios::binary);
+        out.write(responses.data(), responses.size());
+    }
+    if (text)
+        print_text(trace, responses);
+    return 0;
+}
@@ -0,0 +1,101 @@
+#ifndef _RESULT_H_
+#define _RESULT_H_
+
+#include <cstdlib>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <iostream>
+
+namespace cop5536 {
+    /*
+        The outcome of running a command, kept apart from its text form so that executing a command and
+        printing its response can happen in different places. Responses that list values (inrange, topk) may
+        be split across several results, so they never need to be held in memory all at once.
+    */
+    struct Result {
+        enum Kind: uint8_t {
+            NONE,   //nothing to print
+            VALUE,  //first
+            PAIR,   //first second
+            VALUES, //values, space separated
+            PAIRS,  //values, read as alternating id count
+            ERROR   //error
+        };
+        Kind kind;
+        bool continuation; //an earlier result already started this response
+        bool continues; //more results follow for this response
+        uint64_t first, second;
+        std::vector<uint64_t> values;
+        bool has_resume; //the listed range was cut short, and resumes at resume_id
+        uint64_t resume_id;
+        std::string error;
+        Result(): kind(NONE), continuation(false), continues(false), first(0), second(0), has_resume(false), resume_id(0) {}
+        void reset(Kind new_kind) {
+            //reuse the storage of an earlier result
+            kind = new_kind;
+            continuation = continues = has_resume = false;
+            values.clear();
+        }
+
+        /*
+            Print the result in the driver's text format.
+        */
+        void format(std::ostream& out) const {
+            switch (kind) {
+            case NONE:
+                return;
+            case VALUE:
+                out << first << '\n';
+                return;
+            case PAIR:
+                out << first << ' ' << second << '\n';
+                return;
+            case ERROR:
+                out << "Exception: " << error << '\n';
+                return;
+            case VALUES:
+            case PAIRS:
+                break;
+            }
+            //every result but the last in a split response holds at least one value, so a continuation always
+            //follows something already printed
+            bool prepend_space = continuation;
+            for (size_t i = 0; i < values.size(); ++i) {
+                if (prepend_space)
+                    out << ' ';
+                else
+                    prepend_space = true;
+                out << values[i];
+                if (kind == PAIRS)
+                    out << ' ' << values[++i];
+            }
+            if (continues)
+                return;
+            if (has_resume) {
+                if (prepend_space)
+                    out << ' ';
+                out << "next=" << resume_id;
+            }
+            out << '\n';
+        }
+    };
+
+    /*
+        A sink for Driver::execute that prints each result in the text format as soon as it is complete.
+    */
+    struct TextSink {
+        std::ostream& out;
+        Result result;
+        TextSink(std::ostream& out): out(out) {}
+        Result& begin(Result::Kind kind) {
+            result.reset(kind);
+            return result;
+        }
+        void commit() {
+            result.format(out);
+        }
+    };
+}
+
+#endif
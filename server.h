@@ -0,0 +1,274 @@
+#ifndef _SERVER_H_
+#define _SERVER_H_
+
+#include "driver.h"
+
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <stdexcept>
+#include <cerrno>
+#include <cstring>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+
+namespace cop5536 {
+    template <typename Driver>
+    class BasicServer {
+    /*
+        Serves the driver's command set to any number of local clients from a single epoll loop, so the input
+        file is loaded once and the counter is only ever touched by one thread. Clients may pipeline: every
+        complete line in a read is run in order and all of their responses go back in a single write. A client
+        that sends commands faster than it reads the responses is throttled: once max_pending_out bytes of output
+        are waiting for it, its commands are left unread until it has taken most of that output.
+    */
+    private:
+        struct Connection {
+            std::string pending_in; //bytes read but not yet ending in a newline
+            std::string pending_out; //responses not yet accepted by the socket
+            bool quitting; //client sent quit; close once pending_out drains
+            bool reading_paused; //pending_out is over max_pending_out, so nothing more is read or run until it drains
+            uint32_t watched_events;
+            Connection(): quitting(false), reading_paused(false), watched_events(EPOLLIN | EPOLLRDHUP) {}
+        };
+        static const size_t read_chunk_size = 64 * 1024;
+        static const int max_events = 256;
+        static const size_t max_pending_out = 1024 * 1024; //output waiting for a client at which reading from it stops
+        Driver& driver;
+        int listen_fd;
+        int epoll_fd;
+        std::unordered_map<int, Connection> connections;
+        std::ostringstream responses;
+        char read_buf[read_chunk_size];
+
+        static void set_nonblocking(int fd) {
+            int flags = fcntl(fd, F_GETFL, 0);
+            if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0)
+                throw std::runtime_error(std::string("fcntl: ") + strerror(errno));
+        }
+        void watch(int fd, uint32_t events, int op) {
+            epoll_event ev;
+            ev.events = events;
+            ev.data.fd = fd;
+            if (epoll_ctl(epoll_fd, op, fd, &ev) < 0)
+                throw std::runtime_error(std::string("epoll_ctl: ") + strerror(errno));
+        }
+        void start_listening(int fd) {
+            if (listen(fd, SOMAXCONN) < 0)
+                throw std::runtime_error(std::string("listen: ") + strerror(errno));
+            set_nonblocking(fd);
+            listen_fd = fd;
+            watch(listen_fd, EPOLLIN, EPOLL_CTL_ADD);
+        }
+        void accept_all() {
+            while (true) {
+                int fd = accept(listen_fd, nullptr, nullptr);
+                if (fd < 0) {
+                    if (errno == EAGAIN || errno == EWOULDBLOCK)
+                        return;
+                    if (errno == EINTR || errno == ECONNABORTED)
+                        continue;
+                    throw std::runtime_error(std::string("accept: ") + strerror(errno));
+                }
+                set_nonblocking(fd);
+                int one = 1;
+                setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); //fails harmlessly on unix sockets
+                connections[fd] = Connection();
+                watch(fd, connections[fd].watched_events, EPOLL_CTL_ADD);
+            }
+        }
+        void close_connection(int fd) {
+            epoll_ctl(epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+            close(fd);
+            connections.erase(fd);
+        }
+        bool flush(int fd, Connection& conn) {
+            //write as much pending output as the socket takes; returns false if the connection was closed
+            size_t written = 0;
+            while (written < conn.pending_out.size()) {
+                ssize_t n = send(fd, conn.pending_out.data() + written, conn.pending_out.size() - written, MSG_NOSIGNAL);
+                if (n < 0) {
+                    if (errno == EINTR)
+                        continue;
+                    if (errno == EAGAIN || errno == EWOULDBLOCK)
+                        break;
+                    close_connection(fd);
+                    return false;
+                }
+                written += n;
+            }
+            conn.pending_out.erase(0, written);
+            if (conn.reading_paused && conn.pending_out.size() < max_pending_out / 2) {
+                //the client has caught up: run the lines left over from when reading stopped, and read again
+                conn.reading_paused = false;
+                run_lines(conn);
+            }
+            if (conn.pending_out.empty() && conn.quitting) {
+                close_connection(fd);
+                return false;
+            }
+            update_watch(fd, conn);
+            return true;
+        }
+        void update_watch(int fd, Connection& conn) {
+            //only ask to hear about input while reading, and about writability while there is something to write;
+            //after quit, anything more the client sends is never read, so it must not wake the loop either
+            uint32_t events = conn.reading_paused || conn.quitting ? 0 : EPOLLIN | EPOLLRDHUP;
+            if ( ! conn.pending_out.empty())
+                events |= EPOLLOUT;
+            if (events != conn.watched_events) {
+                conn.watched_events = events;
+                watch(fd, events, EPOLL_CTL_MOD);
+            }
+        }
+        void run_lines(Connection& conn) {
+            //run every complete line received so far, collecting all of the responses into one batch, unless that
+            //takes the output waiting for the client past max_pending_out, in which case reading pauses
+            responses.str("");
+            size_t line_start = 0, line_end;
+            while ( ! conn.quitting && (line_end = conn.pending_in.find('\n', line_start)) != std::string::npos) {
+                if (conn.pending_out.size() + static_cast<size_t>(responses.tellp()) >= max_pending_out) {
+                    conn.reading_paused = true;
+                    break;
+                }
+                std::string line(conn.pending_in, line_start, line_end - line_start);
+                if ( ! line.empty() && line.back() == '\r')
+                    line.pop_back();
+                line_start = line_end + 1;
+                if ( ! driver.run_cmd(line, responses))
+                    conn.quitting = true;
+            }
+            conn.pending_in.erase(0, conn.quitting ? conn.pending_in.size() : line_start);
+            conn.pending_out += responses.str();
+        }
+        void read_all(int fd) {
+            Connection& conn = connections[fd];
+            bool peer_closed = false;
+            while ( ! conn.reading_paused && ! conn.quitting) {
+                ssize_t n = recv(fd, read_buf, sizeof(read_buf), 0);
+                if (n > 0) {
+                    conn.pending_in.append(read_buf, n);
+                    run_lines(conn);
+                    continue;
+                }
+                if (n == 0) {
+                    peer_closed = true;
+                } else if (errno == EINTR) {
+                    continue;
+                } else if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    close_connection(fd);
+                    return;
+                }
+                break;
+            }
+            if (peer_closed)
+                conn.quitting = true;
+            flush(fd, conn);
+        }
+    public:
+        BasicServer(Driver& driver): driver(driver), listen_fd(-1), epoll_fd(epoll_create1(0)) {
+            if (epoll_fd < 0)
+                throw std::runtime_error(std::string("epoll_create1: ") + strerror(errno));
+        }
+        ~BasicServer() {
+            for (auto const& conn: connections)
+                close(conn.first);
+            if (listen_fd >= 0)
+                close(listen_fd);
+            close(epoll_fd);
+        }
+        /*
+            Listen on a unix domain socket at the given path, replacing any stale socket there. Any other file at
+            the path is left alone, and the server refuses to start.
+        */
+        void listen_unix(std::string const& path) {
+            sockaddr_un addr;
+            memset(&addr, 0, sizeof(addr));
+            addr.sun_family = AF_UNIX;
+            if (path.size() >= sizeof(addr.sun_path))
+                throw std::domain_error("Socket path is too long: " + path);
+            strcpy(addr.sun_path, path.c_str());
+            int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+            if (fd < 0)
+                throw std::runtime_error(std::string("socket: ") + strerror(errno));
+            //a socket left behind by an earlier run is replaced, but nothing else ever is
+            struct stat st;
+            if (lstat(path.c_str(), &st) == 0) {
+                if ( ! S_ISSOCK(st.st_mode)) {
+                    close(fd);
+                    throw std::runtime_error(path + " already exists and is not a socket");
+                }
+                unlink(path.c_str());
+            }
+            if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+                int bind_errno = errno;
+                close(fd);
+                throw std::runtime_error(std::string("bind: ") + strerror(bind_errno));
+            }
+            start_listening(fd);
+        }
+        /*
+            Listen on the given TCP port of the loopback interface.
+        */
+        void listen_tcp(uint16_t port) {
+            sockaddr_in addr;
+            memset(&addr, 0, sizeof(addr));
+            addr.sin_family = AF_INET;
+            addr.sin_port = htons(port);
+            addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+            int fd = socket(AF_INET, SOCK_STREAM, 0);
+            if (fd < 0)
+                throw std::runtime_error(std::string("socket: ") + strerror(errno));
+            int one = 1;
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            if (bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+                int bind_errno = errno;
+                close(fd);
+                throw std::runtime_error(std::string("bind: ") + strerror(bind_errno));
+            }
+            start_listening(fd);
+        }
+        /*
+            Serve clients until the process is killed.
+        */
+        void run() {
+            epoll_event events[max_events];
+            while (true) {
+                int num_events = epoll_wait(epoll_fd, events, max_events, -1);
+                if (num_events < 0) {
+                    if (errno == EINTR)
+                        continue;
+                    throw std::runtime_error(std::string("epoll_wait: ") + strerror(errno));
+                }
+                for (int i = 0; i < num_events; ++i) {
+                    int fd = events[i].data.fd;
+                    if (fd == listen_fd) {
+                        accept_all();
+                        continue;
+                    }
+                    if (connections.find(fd) == connections.end())
+                        continue; //closed while handling an earlier event in this batch
+                    if (events[i].events & EPOLLERR) {
+                        close_connection(fd);
+                    } else if (events[i].events & (EPOLLIN | EPOLLRDHUP | EPOLLHUP)) {
+                        read_all(fd);
+                    } else if (events[i].events & EPOLLOUT) {
+                        flush(fd, connections[fd]);
+                    }
+                }
+            }
+        }
+    };
+
+    typedef BasicServer<Driver> Server;
+}
+
+#endif
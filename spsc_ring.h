@@ -0,0 +1,129 @@
+#ifndef _SPSC_RING_H_
+#define _SPSC_RING_H_
+
+#include <cstdlib>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <vector>
+#include <stdexcept>
+
+namespace cop5536 {
+    template <typename T>
+    class SpscRing {
+    /*
+        A bounded lock-free queue between exactly one producer thread and one consumer thread. Slots are
+        preallocated and filled in place, so any storage a slot owns (e.g. a vector) is reused rather than
+        reallocated as items pass through. Each side keeps a private copy of the other side's position and only
+        rereads the shared one when that copy says the ring looks full (or empty), which keeps the two cache
+        lines from bouncing on every item.
+
+        A side that has to wait spins briefly, since the other side is usually only a moment behind, and then
+        sleeps until the other side wakes it, so an idle stage costs no CPU. The other side only takes the lock
+        to wake it when a sleeper has said it is there.
+    */
+    private:
+        static const size_t cache_line_size = 64;
+        std::vector<T> slots;
+        size_t mask;
+        alignas(cache_line_size) std::atomic<size_t> read_pos; //next slot the consumer will read
+        size_t cached_write_pos; //consumer's copy of write_pos
+        alignas(cache_line_size) std::atomic<size_t> write_pos; //next slot the producer will fill
+        size_t cached_read_pos; //producer's copy of read_pos
+        alignas(cache_line_size) std::atomic<bool> consumer_sleeping;
+        std::atomic<bool> producer_sleeping;
+        std::atomic<bool> closed; //the producer has published its last item
+        std::mutex sleep_lock;
+        std::condition_variable item_published, slot_released;
+        static const int spin_limit = 100; //times a waiting side yields before going to sleep
+
+        bool has_room() {
+            size_t pos = write_pos.load(std::memory_order_relaxed);
+            if (pos - cached_read_pos == slots.size())
+                cached_read_pos = read_pos.load(std::memory_order_acquire);
+            return pos - cached_read_pos != slots.size();
+        }
+        template <typename Ready>
+        void wait_until(Ready ready, std::atomic<bool>& sleeping, std::condition_variable& wakeup) {
+            //this side waits for the other to move; see the class comment
+            for (int spins = 0; ! ready(); ++spins) {
+                if (spins < spin_limit) {
+                    std::this_thread::yield();
+                    continue;
+                }
+                std::unique_lock<std::mutex> lock(sleep_lock);
+                sleeping.store(true, std::memory_order_relaxed);
+                //pairs with the fence in wake(): either the other side sees sleeping, or we see its update
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                wakeup.wait(lock, ready);
+                sleeping.store(false, std::memory_order_relaxed);
+                return;
+            }
+        }
+        void wake(std::atomic<bool>& sleeping, std::condition_variable& wakeup) {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (sleeping.load(std::memory_order_relaxed)) {
+                std::lock_guard<std::mutex> lock(sleep_lock);
+                wakeup.notify_one();
+            }
+        }
+    public:
+        /*
+            capacity must be a power of two.
+        */
+        SpscRing(size_t capacity): slots(capacity), mask(capacity - 1), read_pos(0), cached_write_pos(0), write_pos(0), cached_read_pos(0), consumer_sleeping(false), producer_sleeping(false), closed(false) {
+            if (capacity == 0 || (capacity & mask) != 0)
+                throw std::domain_error("SpscRing capacity must be a power of two");
+        }
+        /*
+            Producer: wait for a free slot and return it to be filled in. It is not visible to the consumer
+            until publish() is called.
+        */
+        T& claim() {
+            wait_until([this]() { return has_room(); }, producer_sleeping, slot_released);
+            return slots[write_pos.load(std::memory_order_relaxed) & mask];
+        }
+        void publish() {
+            write_pos.store(write_pos.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+            wake(consumer_sleeping, item_published);
+        }
+        /*
+            Producer: say that no more items will be published, so a consumer waiting in wait() gives up.
+        */
+        void close() {
+            closed.store(true, std::memory_order_release);
+            wake(consumer_sleeping, item_published);
+        }
+        /*
+            Consumer: return true IFF an item is waiting, without blocking.
+        */
+        bool has_item() {
+            size_t pos = read_pos.load(std::memory_order_relaxed);
+            if (pos == cached_write_pos)
+                cached_write_pos = write_pos.load(std::memory_order_acquire);
+            return pos != cached_write_pos;
+        }
+        /*
+            Consumer: wait for the next item and return it. It stays valid until release() is called.
+        */
+        T& front() {
+            wait_until([this]() { return has_item(); }, consumer_sleeping, item_published);
+            return slots[read_pos.load(std::memory_order_relaxed) & mask];
+        }
+        /*
+            Consumer: wait until an item is waiting, or the ring is closed and drained. Returns true IFF an item
+            is waiting.
+        */
+        bool wait() {
+            wait_until([this]() { return has_item() || closed.load(std::memory_order_acquire); }, consumer_sleeping, item_published);
+            return has_item();
+        }
+        void release() {
+            read_pos.store(read_pos.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+            wake(producer_sleeping, slot_released);
+        }
+    };
+}
+
+#endif
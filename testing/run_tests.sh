@@ -6,3 +6,47 @@
 ../bbst test_1000.txt < input/commands\ test_1000\ .txt > actual_output/commands\ test_1000\ .txt
 ../bbst test_1000.txt < input/Commands_2\ \ test_1000.txt > actual_output/Commands_2\ \ test_1000.txt
 ../bbst test_100.txt < input/Commands_2\ test_100.txt > actual_output/Commands_2\ test_100.txt
+../bbst test_100.txt < input/Commands_3\ test_100.txt > actual_output/Commands_3\ test_100.txt
+../bbst test_1000.txt < input/Commands_4\ test_1000.txt > actual_output/Commands_4\ test_1000.txt
+../bbst test_100.txt --window 10 < input/Commands_5\ test_100.txt > actual_output/Commands_5\ test_100.txt
+../bbst test_100.txt --approx 4096 10 < input/Commands_6\ test_100.txt > actual_output/Commands_6\ test_100.txt
+../bbst test_1000.txt < input/Commands_7\ test_1000.txt > actual_output/Commands_7\ test_1000.txt
+../bbst test_dense_1000.txt < input/Commands_8\ test_dense_1000.txt > actual_output/Commands_8\ test_dense_1000.txt
+../bbst test_approx_1.txt --approx 64 100 < input/Commands_9\ test_approx_1.txt > actual_output/Commands_9\ test_approx_1.txt
+../bbst test_unsorted.txt < input/Commands_10\ test_unsorted.txt > actual_output/Commands_10\ test_unsorted.txt
+#the arena file must never overwrite an existing file, here the input file itself, which the second run then still loads
+{ ../bbst test_100.txt --arena-file test_100.txt; ../bbst test_100.txt; } < input/Commands_11\ test_100.txt > actual_output/Commands_11\ test_100.txt
+../bbst test_1000.txt --engine wavl < input/Commands_12\ test_1000.txt > actual_output/Commands_12\ test_1000.txt
+#the pipelined and multi-threaded drivers must print exactly what the plain driver does, so run the traces above
+#through each of them and compare against the same expected outputs; each line below is a trace, its input file and
+#its options (the Commands_1 test_1000000 and commands_1 test_1000 traces are left out, since their expected outputs
+#have spaces missing between some counts)
+traces="Commands_1 test_100.txt|test_100.txt|
+commands test_1000 .txt|test_1000.txt|
+Commands_2  test_1000.txt|test_1000.txt|
+Commands_2 test_100.txt|test_100.txt|
+Commands_3 test_100.txt|test_100.txt|
+Commands_4 test_1000.txt|test_1000.txt|
+Commands_5 test_100.txt|test_100.txt|--window 10
+Commands_6 test_100.txt|test_100.txt|--approx 4096 10
+Commands_7 test_1000.txt|test_1000.txt|
+Commands_8 test_dense_1000.txt|test_dense_1000.txt|
+Commands_9 test_approx_1.txt|test_approx_1.txt|--approx 64 100
+Commands_10 test_unsorted.txt|test_unsorted.txt|
+Commands_12 test_1000.txt|test_1000.txt|--engine wavl"
+mismatches=0
+for mode in pipeline threads; do
+    mkdir -p actual_output/$mode
+    while IFS='|' read -r name input_file opts; do
+        if [ $mode = pipeline ]; then
+            ../bbst $input_file $opts --pipeline < "input/$name" > "actual_output/$mode/$name"
+        else
+            ../bbst $input_file $opts --threads 4 < "input/$name" > "actual_output/$mode/$name"
+        fi
+        if ! diff -q "expected_output/$name" "actual_output/$mode/$name" > /dev/null; then
+            echo "Output of $name with --$mode differs from the expected output"
+            mismatches=1
+        fi
+    done <<< "$traces"
+done
+exit $mismatches
@@ -0,0 +1,89 @@
+#ifndef _THREAD_POOL_H_
+#define _THREAD_POOL_H_
+
+#include <cstdlib>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+namespace cop5536 {
+    class ThreadPool {
+    /*
+        A fixed set of worker threads for running one batch of independent tasks at a time. The calling thread
+        works on the batch too, and tasks are handed out one at a time from a shared counter, so uneven tasks
+        still keep every thread busy until the batch is done.
+    */
+    private:
+        std::vector<std::thread> workers;
+        std::mutex mutex;
+        std::condition_variable batch_started, batch_finished;
+        std::function<void(size_t)> task;
+        size_t num_tasks;
+        std::atomic<size_t> next_task;
+        size_t num_busy_workers;
+        size_t batch_number; //bumped for every batch, so a worker never runs the same batch twice
+        bool stopping;
+
+        void run_tasks() {
+            for (size_t t = next_task.fetch_add(1); t < num_tasks; t = next_task.fetch_add(1))
+                task(t);
+        }
+        void work() {
+            size_t last_batch = 0;
+            std::unique_lock<std::mutex> lock(mutex);
+            while (true) {
+                batch_started.wait(lock, [this, last_batch]() { return stopping || batch_number != last_batch; });
+                if (stopping)
+                    return;
+                last_batch = batch_number;
+                lock.unlock();
+                run_tasks();
+                lock.lock();
+                if (--num_busy_workers == 0)
+                    batch_finished.notify_one();
+            }
+        }
+    public:
+        /*
+            A pool running batches on num_threads threads in all, counting the calling thread.
+        */
+        ThreadPool(size_t num_threads): num_tasks(0), next_task(0), num_busy_workers(0), batch_number(0), stopping(false) {
+            for (size_t i = 1; i < num_threads; ++i)
+                workers.push_back(std::thread([this]() { work(); }));
+        }
+        ~ThreadPool() {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                stopping = true;
+            }
+            batch_started.notify_all();
+            for (std::thread& t: workers)
+                t.join();
+        }
+        size_t num_threads() const {
+            return workers.size() + 1;
+        }
+        /*
+            Call task(0) .. task(n - 1), spread over the pool, and return once they have all finished.
+        */
+        void run(size_t n, std::function<void(size_t)> const& batch_task) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                task = batch_task;
+                num_tasks = n;
+                next_task.store(0);
+                num_busy_workers = workers.size();
+                ++batch_number;
+            }
+            batch_started.notify_all();
+            run_tasks();
+            std::unique_lock<std::mutex> lock(mutex);
+            batch_finished.wait(lock, [this]() { return num_busy_workers == 0; });
+        }
+    };
+}
+
+#endif
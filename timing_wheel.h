@@ -0,0 +1,117 @@
+#ifndef _TIMING_WHEEL_H_
+#define _TIMING_WHEEL_H_
+
+#include <cstdlib>
+#include <cstdint>
+#include <vector>
+
+namespace cop5536 {
+    class TimingWheel {
+    /*
+        A hierarchical timing wheel holding (key, value) timers that fire at a given tick. Level L has 64 slots,
+        each spanning 64^L ticks, and a timer lives at the level of the highest 6-bit digit in which its expiry
+        differs from the current tick. That means every timer on a lower level expires before every timer on a
+        higher level, and within a level the slots are ordered, so the next slot due is always the lowest set
+        bit of the lowest non-empty level. Advancing jumps straight from one occupied slot to the next and
+        cascades its timers down a level, so the cost is proportional to the number of timers expired (times
+        at most one cascade per level), not to the number of ticks skipped or to anything else in the counter.
+    */
+    public:
+        typedef uint64_t tick_type;
+        typedef uint64_t key_type;
+        typedef uint64_t value_type;
+    private:
+        struct Timer {
+            tick_type expiry;
+            key_type key;
+            value_type value;
+            Timer(tick_type expiry, key_type key, value_type value): expiry(expiry), key(key), value(value) {}
+        };
+        typedef std::vector<Timer> timer_list;
+        static const size_t slot_bits = 6;
+        static const size_t num_slots = 1 << slot_bits;
+        static const size_t num_levels = (64 + slot_bits - 1) / slot_bits;
+        timer_list slots[num_levels][num_slots];
+        uint64_t occupied[num_levels]; //bit s of occupied[L] is set IFF slots[L][s] is non-empty
+        timer_list cascading; //scratch list, kept around so its storage is reused between advances
+        tick_type now;
+        size_t num_pending;
+        void place(Timer const& timer) {
+            //note: expects timer.expiry > now
+            tick_type differing_bits = timer.expiry ^ now;
+            size_t level = (63 - __builtin_clzll(differing_bits)) / slot_bits;
+            size_t slot = (timer.expiry >> (level * slot_bits)) & (num_slots - 1);
+            slots[level][slot].push_back(timer);
+            occupied[level] |= uint64_t(1) << slot;
+        }
+        tick_type slot_start(size_t level, size_t slot) const {
+            //the first tick covered by a slot: the current tick's digits above the level, then the slot number
+            size_t shift = level * slot_bits;
+            size_t high_shift = shift + slot_bits;
+            tick_type high_bits = high_shift >= 64 ? 0 : (now >> high_shift) << high_shift;
+            return high_bits | (tick_type(slot) << shift);
+        }
+    public:
+        TimingWheel(): now(0), num_pending(0) {
+            for (size_t level = 0; level != num_levels; ++level)
+                occupied[level] = 0;
+        }
+        /*
+            Schedule value to be expired for key at the given tick. Returns false (and schedules nothing) if that
+            tick has already been reached.
+        */
+        bool schedule(tick_type expiry, key_type key, value_type value) {
+            if (expiry <= now)
+                return false;
+            place(Timer(expiry, key, value));
+            ++num_pending;
+            return true;
+        }
+        /*
+            Move the current tick forward to the given tick (moving backward is a no-op), calling
+            on_expire(key, value) for every timer whose expiry has been reached, in expiry order.
+            Returns the number of timers expired.
+        */
+        template <typename ExpireFn>
+        size_t advance(tick_type tick, ExpireFn on_expire) {
+            size_t num_expired = 0;
+            while (num_pending != 0) {
+                size_t level = 0;
+                while (occupied[level] == 0)
+                    ++level;
+                size_t slot = __builtin_ctzll(occupied[level]);
+                tick_type start = slot_start(level, slot);
+                if (start > tick)
+                    break;
+                //jump to the slot and either fire its timers or cascade them to the lower levels
+                now = start;
+                occupied[level] &= ~(uint64_t(1) << slot);
+                cascading.swap(slots[level][slot]);
+                for (Timer const& timer: cascading) {
+                    if (timer.expiry <= now) {
+                        --num_pending;
+                        ++num_expired;
+                        on_expire(timer.key, timer.value);
+                    } else {
+                        place(timer);
+                    }
+                }
+                cascading.clear();
+            }
+            if (tick > now)
+                now = tick;
+            return num_expired;
+        }
+        tick_type current_tick() const {
+            return now;
+        }
+        /*
+            returns the number of timers which have not yet expired.
+        */
+        size_t size() const {
+            return num_pending;
+        }
+    };
+}
+
+#endif
@@ -0,0 +1,35 @@
+/*
+    Converts a text command trace (like the files in testing/input) into the binary command format described in
+    binary_protocol.h, for replaying without any text handling.
+
+    usage: trace2bin < commands.txt > commands.bin
+*/
+#define _DEBUG_ false
+
+#include <iostream>
+#include <string>
+#include "binary_protocol.h"
+
+int main()
+{
+    std::string line, out;
+    size_t num_converted = 0, num_skipped = 0;
+    while (std::getline(std::cin, line)) {
+        if ( ! line.empty() && line.back() == '\r')
+            line.pop_back();
+        if (line.find_first_not_of(' ') == std::string::npos)
+            continue;
+        cop5536::Command cmd;
+        if ( ! cop5536::Command::parse_text(line, cmd)) {
+            ++num_skipped;
+            continue;
+        }
+        cop5536::binary_protocol::encode_command(cmd, out);
+        ++num_converted;
+        if (cmd.op == cop5536::Command::QUIT)
+            break;
+    }
+    std::cout.write(out.data(), out.size());
+    std::cerr << num_converted << " commands converted, " << num_skipped << " lines skipped" << std::endl;
+    return 0;
+}
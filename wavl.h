@@ -0,0 +1,375 @@
+#ifndef _WAVL_H_
+#define _WAVL_H_
+
+#include <cstdlib>
+#include <sstream>
+#include <string>
+#include "bst.h"
+
+namespace cop5536 {
+    class WAVL: public BST {
+    /*
+        A weak AVL tree: every node has a rank, and the rank difference between a node and each of its children
+        (with missing children at rank -1) is 1 or 2, with leaves at rank 0. Only the two rank differences are
+        stored, one bit each, so ranks are never stored or recomputed. Insertion and deletion walk back up the
+        search path promoting or demoting ranks until the tree is valid again, and then stop; each update does at
+        most two rotations, and the promotions/demotions are O(1) amortized. Deletion in particular is cheaper
+        than AVL's, which may rotate at every level on the way back up.
+
+        As with AVL, we inherit from the BST base class and override its recursive insert/remove hooks. The
+        node's height field is left alone, as nothing here reads it.
+    */
+    protected:
+        using super = BST;
+        using typename super::Node;
+        size_t num_rotations;
+
+        static uint8_t side_bit(bool right) {
+            return right ? 2 : 1;
+        }
+        bool is_rank_diff_2(size_t node_index, bool right) const {
+            return (nodes[node_index].rank_diffs & side_bit(right)) != 0;
+        }
+        void set_rank_diff_2(size_t node_index, bool right, bool is_2) {
+            if (is_2)
+                nodes[node_index].rank_diffs |= side_bit(right);
+            else
+                nodes[node_index].rank_diffs &= ~side_bit(right);
+        }
+        size_t& child_index(size_t node_index, bool right) {
+            return right ? nodes[node_index].right_index : nodes[node_index].left_index;
+        }
+        bool is_leaf(size_t node_index) const {
+            return nodes[node_index].left_index == 0 && nodes[node_index].right_index == 0;
+        }
+        void update_num_children(size_t node_index) {
+            Node& n = nodes[node_index];
+            n.num_children = 0;
+            if (n.left_index != 0)
+                n.num_children += 1 + nodes[n.left_index].num_children;
+            if (n.right_index != 0)
+                n.num_children += 1 + nodes[n.right_index].num_children;
+        }
+        void rotate_up(size_t& subtree_root_index, bool right) {
+            //make the child on the given side the root of this subtree; the caller fixes up rank differences
+            size_t old_root_index = subtree_root_index;
+            size_t child = child_index(old_root_index, right);
+            //original root adopts the child's inner subtree, and the child adopts the original root
+            child_index(old_root_index, right) = child_index(child, ! right);
+            child_index(child, ! right) = old_root_index;
+            //the new root covers exactly the nodes the original root did
+            nodes[child].num_children = nodes[old_root_index].num_children;
+            update_num_children(old_root_index);
+            nodes[old_root_index].update_max_value(nodes);
+            nodes[child].update_max_value(nodes);
+            subtree_root_index = child;
+            ++num_rotations;
+        }
+        void rebalance_after_insert(size_t& subtree_root_index, bool right, bool& rank_increased) {
+            //the rank of the child on the given side went up by one; fix the rank differences of this subtree,
+            //setting rank_increased if the subtree root's own rank went up as a result
+            size_t x = subtree_root_index;
+            rank_increased = false;
+            if (is_rank_diff_2(x, right)) {
+                //the child was two ranks below, and now is one below, which is fine
+                set_rank_diff_2(x, right, false);
+                return;
+            }
+            //the child now has the same rank as this node
+            if ( ! is_rank_diff_2(x, ! right)) {
+                //promote this node, which pushes the problem up a level
+                set_rank_diff_2(x, right, false);
+                set_rank_diff_2(x, ! right, true);
+                rank_increased = true;
+                return;
+            }
+            size_t c = child_index(x, right);
+            if ( ! is_rank_diff_2(c, right)) {
+                //the child's outer subtree is the tall one: rotate the child up and demote this node
+                rotate_up(subtree_root_index, right);
+                nodes[x].rank_diffs = 0;
+                nodes[c].rank_diffs = 0;
+            } else {
+                //the child's inner subtree is the tall one: rotate the inner grandchild up twice, promoting it
+                //and demoting the child and this node, which each adopt one of its subtrees
+                size_t z = child_index(c, ! right);
+                bool z_inner_rd_2 = is_rank_diff_2(z, right), z_outer_rd_2 = is_rank_diff_2(z, ! right);
+                rotate_up(child_index(x, right), ! right);
+                rotate_up(subtree_root_index, right);
+                set_rank_diff_2(c, right, false);
+                set_rank_diff_2(c, ! right, z_inner_rd_2);
+                set_rank_diff_2(x, right, z_outer_rd_2);
+                set_rank_diff_2(x, ! right, false);
+                nodes[z].rank_diffs = 0;
+            }
+        }
+        void rebalance_after_remove(size_t& subtree_root_index, bool right, bool& rank_decreased) {
+            //the rank of the child on the given side went down by one; fix the rank differences of this subtree,
+            //setting rank_decreased if the subtree root's own rank went down as a result
+            size_t x = subtree_root_index;
+            rank_decreased = false;
+            if ( ! is_rank_diff_2(x, right)) {
+                //the child was one rank below, and now is two below, which is fine unless this node is now a
+                //leaf, which must be at rank 0
+                set_rank_diff_2(x, right, true);
+                if (is_leaf(x)) {
+                    nodes[x].rank_diffs = 0;
+                    rank_decreased = true;
+                }
+                return;
+            }
+            //the child is now three ranks below this node
+            size_t y = child_index(x, ! right);
+            if (is_rank_diff_2(x, ! right)) {
+                //the sibling is two ranks below too, so demote this node
+                set_rank_diff_2(x, ! right, false);
+                rank_decreased = true;
+                return;
+            }
+            if (is_rank_diff_2(y, false) && is_rank_diff_2(y, true)) {
+                //the sibling can be demoted along with this node
+                set_rank_diff_2(x, ! right, false);
+                nodes[y].rank_diffs = 0;
+                rank_decreased = true;
+                return;
+            }
+            if ( ! is_rank_diff_2(y, ! right)) {
+                //the sibling's outer subtree is the tall one: rotate the sibling up, promoting it and demoting
+                //this node (twice, if that leaves it a leaf)
+                bool w_rd_2 = is_rank_diff_2(y, right);
+                rotate_up(subtree_root_index, ! right);
+                if (is_leaf(x)) {
+                    nodes[x].rank_diffs = 0;
+                    set_rank_diff_2(y, right, true);
+                } else {
+                    set_rank_diff_2(x, right, true);
+                    set_rank_diff_2(x, ! right, w_rd_2);
+                    set_rank_diff_2(y, right, false);
+                }
+                set_rank_diff_2(y, ! right, true);
+            } else {
+                //the sibling's inner subtree is the tall one: rotate the inner grandchild up twice, promoting it
+                //twice and demoting the sibling once and this node twice
+                size_t w = child_index(y, right);
+                bool w_inner_rd_2 = is_rank_diff_2(w, right), w_outer_rd_2 = is_rank_diff_2(w, ! right);
+                rotate_up(child_index(x, ! right), right);
+                rotate_up(subtree_root_index, ! right);
+                set_rank_diff_2(x, right, false);
+                set_rank_diff_2(x, ! right, w_inner_rd_2);
+                set_rank_diff_2(y, right, w_outer_rd_2);
+                set_rank_diff_2(y, ! right, false);
+                nodes[w].rank_diffs = side_bit(false) | side_bit(true);
+            }
+        }
+        int insert_at_leaf(size_t nodes_visited, //starts at 0 when this function is first called (ie does not include current node visitation)
+                           size_t& subtree_root_index,
+                           key_type const& key,
+                           value_type const& value,
+                           bool& found_key)
+        {
+            bool rank_increased = false;
+            return do_insert(nodes_visited, subtree_root_index, key, value, found_key, rank_increased);
+        }
+        int do_insert(size_t nodes_visited,
+                      size_t& subtree_root_index,
+                      key_type const& key,
+                      value_type const& value,
+                      bool& found_key,
+                      bool& rank_increased)
+        {
+            if (subtree_root_index == 0) {
+                //key not found, so add a leaf, which is one rank above the missing child it replaces
+                subtree_root_index = procure_node(key, value);
+                rank_increased = true;
+                return nodes_visited;
+            }
+            Node& subtree_root = nodes[subtree_root_index];
+            ++nodes_visited;
+            if (key == subtree_root.key) {
+                //found key, replace the value
+                subtree_root.value = value;
+                subtree_root.update_max_value(nodes);
+                found_key = true;
+                return nodes_visited;
+            }
+            bool right = key > subtree_root.key;
+            bool is_parent = child_index(subtree_root_index, right) == 0;
+            nodes_visited = do_insert(nodes_visited, child_index(subtree_root_index, right), key, value, found_key, rank_increased);
+            if ( ! found_key) {
+                //given key is unique to the tree, so a new node was added
+                subtree_root.num_children++;
+                if (is_parent) {
+                    if (right)
+                        link_after(subtree_root_index, subtree_root.right_index);
+                    else
+                        link_before(subtree_root_index, subtree_root.left_index);
+                }
+            }
+            subtree_root.update_max_value(nodes);
+            if (rank_increased)
+                rebalance_after_insert(subtree_root_index, right, rank_increased);
+            return nodes_visited;
+        }
+        size_t remove_smallest(size_t& subtree_root_index, bool& rank_decreased) {
+            //returns the index of the node with the smallest key, having replaced it with its right child
+            //(a leaf, if any), and rebalanced the path up to this subtree's root
+            Node& subtree_root = nodes[subtree_root_index];
+            if (subtree_root.left_index == 0) {
+                size_t smallest_key_node_index = subtree_root_index;
+                subtree_root_index = subtree_root.right_index;
+                rank_decreased = true;
+                return smallest_key_node_index;
+            }
+            size_t smallest_key_node_index = remove_smallest(subtree_root.left_index, rank_decreased);
+            subtree_root.num_children--;
+            subtree_root.update_max_value(nodes);
+            if (rank_decreased)
+                rebalance_after_remove(subtree_root_index, false, rank_decreased);
+            return smallest_key_node_index;
+        }
+        void remove_node(size_t& subtree_root_index, bool& rank_decreased) {
+            size_t index_to_delete = subtree_root_index;
+            Node& subtree_root = nodes[index_to_delete];
+            if (subtree_root.right_index) {
+                //replace the root with the smallest-keyed node in the right subtree, which takes over the old
+                //root's place in the tree, including its rank
+                bool right_rank_decreased = false;
+                size_t new_root_index = remove_smallest(subtree_root.right_index, right_rank_decreased);
+                Node& new_root = nodes[new_root_index];
+                new_root.left_index = subtree_root.left_index;
+                new_root.right_index = subtree_root.right_index;
+                new_root.num_children = subtree_root.num_children - 1;
+                new_root.rank_diffs = subtree_root.rank_diffs;
+                new_root.update_max_value(nodes);
+                subtree_root_index = new_root_index;
+                rank_decreased = false;
+                if (right_rank_decreased)
+                    rebalance_after_remove(subtree_root_index, true, rank_decreased);
+            } else {
+                //the root is a leaf, or has a single leaf child, which takes its place a rank lower
+                subtree_root_index = subtree_root.left_index;
+                rank_decreased = true;
+            }
+            unlink(index_to_delete);
+            add_node_to_free_tree(index_to_delete);
+        }
+        int do_remove(size_t nodes_visited, //starts at 0 when this function is first called (ie does not include current node visitation)
+                      size_t& subtree_root_index,
+                      key_type const& key,
+                      value_type& value,
+                      bool& found_key)
+        {
+            bool rank_decreased = false;
+            return do_remove(nodes_visited, subtree_root_index, key, value, found_key, rank_decreased);
+        }
+        int do_remove(size_t nodes_visited,
+                      size_t& subtree_root_index,
+                      key_type const& key,
+                      value_type& value,
+                      bool& found_key,
+                      bool& rank_decreased)
+        {
+            if (subtree_root_index == 0)
+                return nodes_visited;
+            Node& subtree_root = nodes[subtree_root_index];
+            ++nodes_visited;
+            if (key == subtree_root.key) {
+                //found key, remove the node
+                found_key = true;
+                value = subtree_root.value;
+                remove_node(subtree_root_index, rank_decreased);
+                return nodes_visited;
+            }
+            bool right = key > subtree_root.key;
+            nodes_visited = do_remove(nodes_visited, child_index(subtree_root_index, right), key, value, found_key, rank_decreased);
+            if (found_key) {
+                subtree_root.num_children--;
+                subtree_root.update_max_value(nodes);
+                if (rank_decreased)
+                    rebalance_after_remove(subtree_root_index, right, rank_decreased);
+            }
+            return nodes_visited;
+        }
+        long rank(size_t node_index) const {
+            //this function is for debugging purposes, adds up the rank differences down the left spine, in
+            //O(log N) time
+            long r = -1;
+            for (; node_index != 0; node_index = nodes[node_index].left_index)
+                r += is_rank_diff_2(node_index, false) ? 2 : 1;
+            return r;
+        }
+        void validate_balance(size_t node_index) const {
+            //this function is for debugging purposes, checks that both children agree on the node's rank; the
+            //height field isn't kept up to date here, so it isn't checked
+            Node const& n = nodes[node_index];
+            long r = rank(node_index);
+            if (r != rank(n.right_index) + (is_rank_diff_2(node_index, true) ? 2 : 1))
+                throw std::domain_error("Children disagree on the rank of their parent in a rank-balanced tree");
+            if (is_leaf(node_index) && r != 0)
+                throw std::domain_error("Unexpected leaf with nonzero rank in a rank-balanced tree");
+        }
+        size_t init_from_sorted_slots(const size_t start_idx, const size_t end_idx) {
+            //a tree built from the middle out is height balanced, so a node's rank can be taken as its height less
+            //one, and the rank differences are the height differences
+            size_t root_dst_idx = super::init_from_sorted_slots(start_idx, end_idx);
+            if (root_dst_idx > 0) {
+                Node& n = nodes[root_dst_idx];
+                n.rank_diffs = 0;
+                set_rank_diff_2(root_dst_idx, false, n.height - nodes[n.left_index].height == 2);
+                set_rank_diff_2(root_dst_idx, true, n.height - nodes[n.right_index].height == 2);
+            }
+            return root_dst_idx;
+        }
+    public:
+        WAVL(size_t init_capacity): super(init_capacity), num_rotations(0) {}
+        /*
+            Initialize a WAVL tree using a list of key-values, sorted by key, in O(N) time
+        */
+        WAVL(const kv_list& init_kvs): WAVL(std::max<size_t>(1, init_kvs.size())) {
+            build_from_kv_list(init_kvs);
+        }
+        /*
+            Adds the specified key/value-pair to the tree and returns the number of
+            nodes visited, V. Increases capacity if necessary. If an item already
+            exists in the tree with the same key, replace its value.
+        */
+        int insert(key_type const& key, value_type const& value) {
+            if (this->size() == this->capacity()) {
+                //no more space - need to increase the capacity
+                increase_capacity();
+            }
+            bool found_key = false;
+            key_type k(key);
+            value_type v(value);
+            int nodes_visited = insert_at_leaf(0, this->root_index, k, v, found_key);
+            if (_DEBUG_)
+                this->validate_after_insert(key);
+            return nodes_visited;
+        }
+        /*
+            if there is an item matching key, removes the key/value-pair from the tree, stores
+            it's value in value, and returns the number of probes required, V; otherwise returns -1 * V.
+        */
+        int remove(key_type const& key, value_type& value) {
+            if (this->is_empty())
+                return 0;
+            bool found_key = false;
+            key_type k(key);
+            value_type v(value);
+            int nodes_visited = do_remove(0, this->root_index, k, v, found_key);
+            if (_DEBUG_)
+                this->validate_after_remove(key);
+            if (found_key)
+                value = v;
+            return found_key ? nodes_visited : -1 * nodes_visited;
+        }
+        /*
+            returns the number of rotations done since the tree was created.
+        */
+        size_t rotations() const {
+            return num_rotations;
+        }
+    };
+}
+
+#endif